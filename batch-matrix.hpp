@@ -0,0 +1,507 @@
+#pragma once
+
+#include "fixed-matrix.hpp"
+#include "matrix.hpp"
+#include "thread-pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <type_traits>
+#include <vector>
+
+// Marks a loop over the lanes of a block as free of loop-carried dependences, so it vectorizes without runtime alias checks
+#if defined(__clang__)
+#define ZAOLY_BATCH_LANES_LOOP _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define ZAOLY_BATCH_LANES_LOOP _Pragma("GCC ivdep")
+#elif defined(_MSC_VER)
+#define ZAOLY_BATCH_LANES_LOOP __pragma(loop(ivdep))
+#else
+#define ZAOLY_BATCH_LANES_LOOP
+#endif
+
+namespace zaoly
+{
+	template <typename number>
+	struct batch_lanes : std::integral_constant<size_t, sizeof(number) < 64 ? 64 / sizeof(number) : 1> {}; // Entries per kernel block, one cache line of each element
+
+	template <typename number, size_t _row_count, size_t _column_count>
+	class batch_matrix // Many matrices of one shape in structure-of-arrays layout: element (i, j) of every entry is contiguous, so SIMD lanes map to entries
+	{
+		static_assert(_row_count > 0 && _column_count > 0, "Matrix too small");
+
+	public:
+		using value_type = number;
+		using entry_type = fixed_matrix<number, _row_count, _column_count>;
+
+		static constexpr size_t lanes = batch_lanes<number>::value;
+
+		batch_matrix() {}
+
+		explicit batch_matrix(size_t size)
+		{
+			resize(size);
+		}
+
+		static constexpr size_t row_count()
+		{
+			return _row_count;
+		}
+
+		static constexpr size_t column_count()
+		{
+			return _column_count;
+		}
+
+		size_t size() const
+		{
+			return _size;
+		}
+
+		size_t stride() const // Distance between element (i, j) and the next element of the same entry, a multiple of lanes
+		{
+			return _stride;
+		}
+
+		void resize(size_t size) // Existing entries are kept up to the new size, new entries are zero
+		{
+			const size_t new_stride = (size + lanes - 1) / lanes * lanes;
+			if (new_stride != _stride)
+			{
+				std::vector<number, aligned_allocator<number>> new_data(new_stride * _row_count * _column_count);
+				for (size_t element = 0; element < _row_count * _column_count; ++element)
+					for (size_t index = 0; index < std::min(_size, size); ++index)
+						new_data[element * new_stride + index] = _data[element * _stride + index];
+				_data.swap(new_data);
+				_stride = new_stride;
+			}
+			else // Dropped or added entries within the padding are cleared
+				for (size_t element = 0; element < _row_count * _column_count; ++element)
+					for (size_t index = std::min(_size, size); index < std::max(_size, size); ++index)
+						_data[element * _stride + index] = number{};
+			_size = size;
+		}
+
+		number* data()
+		{
+			return _data.data();
+		}
+
+		const number* data() const
+		{
+			return _data.data();
+		}
+
+		number* data(size_t row_index, size_t column_index) // Element (i, j) of every entry, size() values followed by padding
+		{
+			if (row_index >= _row_count || column_index >= _column_count)
+				throw subscript_out_of_range();
+			return _data.data() + (row_index * _column_count + column_index) * _stride;
+		}
+
+		const number* data(size_t row_index, size_t column_index) const
+		{
+			if (row_index >= _row_count || column_index >= _column_count)
+				throw subscript_out_of_range();
+			return _data.data() + (row_index * _column_count + column_index) * _stride;
+		}
+
+		number& operator()(size_t index, size_t row_index, size_t column_index)
+		{
+			if (index >= _size)
+				throw subscript_out_of_range();
+			return data(row_index, column_index)[index];
+		}
+
+		const number& operator()(size_t index, size_t row_index, size_t column_index) const
+		{
+			if (index >= _size)
+				throw subscript_out_of_range();
+			return data(row_index, column_index)[index];
+		}
+
+		entry_type get(size_t index) const // Gathers one entry
+		{
+			if (index >= _size)
+				throw subscript_out_of_range();
+			entry_type result;
+			for (size_t element = 0; element < _row_count * _column_count; ++element)
+				result.data()[element] = _data[element * _stride + index];
+			return result;
+		}
+
+		void set(size_t index, const entry_type& entry) // Scatters one entry
+		{
+			if (index >= _size)
+				throw subscript_out_of_range();
+			for (size_t element = 0; element < _row_count * _column_count; ++element)
+				_data[element * _stride + index] = entry.data()[element];
+		}
+
+		void push_back(const entry_type& entry)
+		{
+			resize(_size + 1);
+			set(_size - 1, entry);
+		}
+
+	private:
+		size_t _size{}, _stride{};
+		std::vector<number, aligned_allocator<number>> _data;
+	};
+
+	template <typename number, size_t _row_count, size_t _column_count>
+	constexpr size_t batch_matrix<number, _row_count, _column_count>::lanes;
+
+	template <typename number>
+	struct batch_kernel // Works on one block of lanes entries at a time: every loop over lanes has a constant trip count and independent iterations, so it compiles to vector code
+	{
+		static constexpr size_t lanes = batch_lanes<number>::value;
+
+		template <size_t m, size_t k, size_t n>
+		static void multiply_blocks(batch_matrix<number, m, n>& c, const batch_matrix<number, m, k>& a, const batch_matrix<number, k, n>& b, size_t block_begin, size_t block_end) // Entries [block_begin * lanes, block_end * lanes)
+		{
+			for (size_t block = block_begin; block < block_end; ++block)
+				multiply<m, k, n>(a.data() + block * lanes, b.data() + block * lanes, c.data() + block * lanes, a.stride());
+		}
+
+		template <size_t size>
+		static void determinant_blocks(std::vector<number>& result, const batch_matrix<number, size, size>& src, size_t block_begin, size_t block_end)
+		{
+			number det[lanes];
+			for (size_t block = block_begin; block < block_end; ++block)
+			{
+				const size_t first = block * lanes, valid = std::min(lanes, src.size() - first);
+				determinant(src.data() + first, det, src.stride(), valid, std::integral_constant<size_t, size>());
+				std::copy(det, det + valid, result.begin() + first);
+			}
+		}
+
+		template <size_t size>
+		static bool inverse_blocks(batch_matrix<number, size, size>& result, const batch_matrix<number, size, size>& src, size_t block_begin, size_t block_end) // False when an entry in the range is singular
+		{
+			bool invertible = true;
+			for (size_t block = block_begin; block < block_end; ++block)
+			{
+				const size_t first = block * lanes;
+				invertible &= inverse(src.data() + first, result.data() + first, src.stride(), std::min(lanes, src.size() - first), std::integral_constant<size_t, size>());
+			}
+			return invertible;
+		}
+
+	private:
+		template <size_t m, size_t k, size_t n>
+		static void multiply(const number* a, const number* b, number* c, size_t stride) // The block is finished before it is stored, so c may be a or b
+		{
+			number block[m * n][lanes];
+			for (size_t row_index = 0; row_index < m; ++row_index)
+				for (size_t column_index = 0; column_index < n; ++column_index)
+				{
+					number* sum = block[row_index * n + column_index];
+					const number* a_element = a + row_index * k * stride;
+					const number* b_element = b + column_index * stride;
+					ZAOLY_BATCH_LANES_LOOP
+					for (size_t lane = 0; lane < lanes; ++lane)
+						sum[lane] = a_element[lane] * b_element[lane];
+					for (size_t mid_index = 1; mid_index < k; ++mid_index)
+					{
+						a_element = a + (row_index * k + mid_index) * stride;
+						b_element = b + (mid_index * n + column_index) * stride;
+						ZAOLY_BATCH_LANES_LOOP
+						for (size_t lane = 0; lane < lanes; ++lane)
+							sum[lane] += a_element[lane] * b_element[lane];
+					}
+				}
+			store<m * n>(block, c, stride);
+		}
+
+		template <size_t count>
+		static void store(const number (&block)[count][lanes], number* dest, size_t stride)
+		{
+			for (size_t element = 0; element < count; ++element)
+				ZAOLY_BATCH_LANES_LOOP
+				for (size_t lane = 0; lane < lanes; ++lane)
+					dest[element * stride + lane] = block[element][lane];
+		}
+
+		static bool any_singular(const number* det, size_t valid) // Padding entries are ignored
+		{
+			bool result = false;
+			for (size_t lane = 0; lane < valid; ++lane)
+				result |= det[lane] == number{};
+			return result;
+		}
+
+		static void reciprocal(const number* det, number* result) // Zero stays zero instead of dividing by it
+		{
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t lane = 0; lane < lanes; ++lane)
+				result[lane] = number(1) / (det[lane] == number{} ? number(1) : det[lane]);
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t lane = 0; lane < lanes; ++lane)
+				if (det[lane] == number{})
+					result[lane] = number{};
+		}
+
+		static void determinant(const number* a, number* result, size_t, size_t, std::integral_constant<size_t, 1>)
+		{
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t lane = 0; lane < lanes; ++lane)
+				result[lane] = a[lane];
+		}
+
+		static void determinant(const number* a, number* result, size_t stride, size_t, std::integral_constant<size_t, 2>)
+		{
+			const number* a00 = a, * a01 = a + stride, * a10 = a + 2 * stride, * a11 = a + 3 * stride;
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t lane = 0; lane < lanes; ++lane)
+				result[lane] = a00[lane] * a11[lane] - a01[lane] * a10[lane];
+		}
+
+		static void determinant(const number* a, number* result, size_t stride, size_t, std::integral_constant<size_t, 3>)
+		{
+			number c0[lanes], c1[lanes], c2[lanes];
+			cofactors3(a, stride, c0, c1, c2);
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t lane = 0; lane < lanes; ++lane)
+				result[lane] = a[lane] * c0[lane] + a[stride + lane] * c1[lane] + a[2 * stride + lane] * c2[lane];
+		}
+
+		static void determinant(const number* a, number* result, size_t stride, size_t, std::integral_constant<size_t, 4>)
+		{
+			number s[6][lanes], c[6][lanes];
+			minors4(a, stride, s, c);
+			determinant4(s, c, result);
+		}
+
+		template <size_t size>
+		static void determinant(const number* a, number* result, size_t stride, size_t valid, std::integral_constant<size_t, size>) // Larger sizes run fixed_matrix's elimination one entry at a time
+		{
+			for (size_t lane = 0; lane < valid; ++lane)
+				result[lane] = gather<size>(a, stride, lane).determinant();
+		}
+
+		static bool inverse(const number* a, number* result, size_t, size_t valid, std::integral_constant<size_t, 1>)
+		{
+			number block[1][lanes];
+			reciprocal(a, block[0]);
+			const bool singular = any_singular(a, valid);
+			store<1>(block, result, 0);
+			return !singular;
+		}
+
+		static bool inverse(const number* a, number* result, size_t stride, size_t valid, std::integral_constant<size_t, 2>)
+		{
+			number det[lanes], scale[lanes], block[4][lanes];
+			determinant(a, det, stride, valid, std::integral_constant<size_t, 2>());
+			reciprocal(det, scale);
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				block[0][lane] = a[3 * stride + lane] * scale[lane];
+				block[1][lane] = -a[stride + lane] * scale[lane];
+				block[2][lane] = -a[2 * stride + lane] * scale[lane];
+				block[3][lane] = a[lane] * scale[lane];
+			}
+			store<4>(block, result, stride);
+			return !any_singular(det, valid);
+		}
+
+		static bool inverse(const number* a, number* result, size_t stride, size_t valid, std::integral_constant<size_t, 3>) // Adjugate over determinant
+		{
+			number c0[lanes], c1[lanes], c2[lanes], det[lanes], scale[lanes], block[9][lanes];
+			cofactors3(a, stride, c0, c1, c2);
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t lane = 0; lane < lanes; ++lane)
+				det[lane] = a[lane] * c0[lane] + a[stride + lane] * c1[lane] + a[2 * stride + lane] * c2[lane];
+			reciprocal(det, scale);
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				const auto at = [&](size_t row_index, size_t column_index) { return a[(row_index * 3 + column_index) * stride + lane]; };
+				block[0][lane] = c0[lane] * scale[lane];
+				block[1][lane] = (at(0, 2) * at(2, 1) - at(0, 1) * at(2, 2)) * scale[lane];
+				block[2][lane] = (at(0, 1) * at(1, 2) - at(0, 2) * at(1, 1)) * scale[lane];
+				block[3][lane] = c1[lane] * scale[lane];
+				block[4][lane] = (at(0, 0) * at(2, 2) - at(0, 2) * at(2, 0)) * scale[lane];
+				block[5][lane] = (at(0, 2) * at(1, 0) - at(0, 0) * at(1, 2)) * scale[lane];
+				block[6][lane] = c2[lane] * scale[lane];
+				block[7][lane] = (at(0, 1) * at(2, 0) - at(0, 0) * at(2, 1)) * scale[lane];
+				block[8][lane] = (at(0, 0) * at(1, 1) - at(0, 1) * at(1, 0)) * scale[lane];
+			}
+			store<9>(block, result, stride);
+			return !any_singular(det, valid);
+		}
+
+		static bool inverse(const number* a, number* result, size_t stride, size_t valid, std::integral_constant<size_t, 4>) // Adjugate built from the same 2x2 minors as the determinant
+		{
+			number s[6][lanes], c[6][lanes], det[lanes], scale[lanes], block[16][lanes];
+			minors4(a, stride, s, c);
+			determinant4(s, c, det);
+			reciprocal(det, scale);
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				const auto at = [&](size_t row_index, size_t column_index) { return a[(row_index * 4 + column_index) * stride + lane]; };
+				const number s0 = s[0][lane], s1 = s[1][lane], s2 = s[2][lane], s3 = s[3][lane], s4 = s[4][lane], s5 = s[5][lane];
+				const number c0 = c[0][lane], c1 = c[1][lane], c2 = c[2][lane], c3 = c[3][lane], c4 = c[4][lane], c5 = c[5][lane];
+				const number r = scale[lane];
+				block[0][lane] = (at(1, 1) * c5 - at(1, 2) * c4 + at(1, 3) * c3) * r;
+				block[1][lane] = (-at(0, 1) * c5 + at(0, 2) * c4 - at(0, 3) * c3) * r;
+				block[2][lane] = (at(3, 1) * s5 - at(3, 2) * s4 + at(3, 3) * s3) * r;
+				block[3][lane] = (-at(2, 1) * s5 + at(2, 2) * s4 - at(2, 3) * s3) * r;
+				block[4][lane] = (-at(1, 0) * c5 + at(1, 2) * c2 - at(1, 3) * c1) * r;
+				block[5][lane] = (at(0, 0) * c5 - at(0, 2) * c2 + at(0, 3) * c1) * r;
+				block[6][lane] = (-at(3, 0) * s5 + at(3, 2) * s2 - at(3, 3) * s1) * r;
+				block[7][lane] = (at(2, 0) * s5 - at(2, 2) * s2 + at(2, 3) * s1) * r;
+				block[8][lane] = (at(1, 0) * c4 - at(1, 1) * c2 + at(1, 3) * c0) * r;
+				block[9][lane] = (-at(0, 0) * c4 + at(0, 1) * c2 - at(0, 3) * c0) * r;
+				block[10][lane] = (at(3, 0) * s4 - at(3, 1) * s2 + at(3, 3) * s0) * r;
+				block[11][lane] = (-at(2, 0) * s4 + at(2, 1) * s2 - at(2, 3) * s0) * r;
+				block[12][lane] = (-at(1, 0) * c3 + at(1, 1) * c1 - at(1, 2) * c0) * r;
+				block[13][lane] = (at(0, 0) * c3 - at(0, 1) * c1 + at(0, 2) * c0) * r;
+				block[14][lane] = (-at(3, 0) * s3 + at(3, 1) * s1 - at(3, 2) * s0) * r;
+				block[15][lane] = (at(2, 0) * s3 - at(2, 1) * s1 + at(2, 2) * s0) * r;
+			}
+			store<16>(block, result, stride);
+			return !any_singular(det, valid);
+		}
+
+		template <size_t size>
+		static bool inverse(const number* a, number* result, size_t stride, size_t valid, std::integral_constant<size_t, size>) // Larger sizes run fixed_matrix's elimination one entry at a time
+		{
+			bool invertible = true;
+			for (size_t lane = 0; lane < valid; ++lane)
+			{
+				const fixed_matrix<number, size, size> entry = gather<size>(a, stride, lane);
+				if (!entry.invertible())
+				{
+					invertible = false; // The other entries are still inverted, as for the smaller sizes
+					continue;
+				}
+				const fixed_matrix<number, size, size> inverse = entry.inverse();
+				for (size_t element = 0; element < size * size; ++element)
+					result[element * stride + lane] = inverse.data()[element];
+			}
+			return invertible;
+		}
+
+		template <size_t size>
+		static fixed_matrix<number, size, size> gather(const number* a, size_t stride, size_t lane)
+		{
+			fixed_matrix<number, size, size> result;
+			for (size_t element = 0; element < size * size; ++element)
+				result.data()[element] = a[element * stride + lane];
+			return result;
+		}
+
+		static void cofactors3(const number* a, size_t stride, number* c0, number* c1, number* c2) // Cofactors of the first row
+		{
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				const auto at = [&](size_t row_index, size_t column_index) { return a[(row_index * 3 + column_index) * stride + lane]; };
+				c0[lane] = at(1, 1) * at(2, 2) - at(1, 2) * at(2, 1);
+				c1[lane] = at(1, 2) * at(2, 0) - at(1, 0) * at(2, 2);
+				c2[lane] = at(1, 0) * at(2, 1) - at(1, 1) * at(2, 0);
+			}
+		}
+
+		static void minors4(const number* a, size_t stride, number (&s)[6][lanes], number (&c)[6][lanes]) // 2x2 minors of the top two and the bottom two rows
+		{
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				const auto at = [&](size_t row_index, size_t column_index) { return a[(row_index * 4 + column_index) * stride + lane]; };
+				s[0][lane] = at(0, 0) * at(1, 1) - at(1, 0) * at(0, 1);
+				s[1][lane] = at(0, 0) * at(1, 2) - at(1, 0) * at(0, 2);
+				s[2][lane] = at(0, 0) * at(1, 3) - at(1, 0) * at(0, 3);
+				s[3][lane] = at(0, 1) * at(1, 2) - at(1, 1) * at(0, 2);
+				s[4][lane] = at(0, 1) * at(1, 3) - at(1, 1) * at(0, 3);
+				s[5][lane] = at(0, 2) * at(1, 3) - at(1, 2) * at(0, 3);
+				c[5][lane] = at(2, 2) * at(3, 3) - at(3, 2) * at(2, 3);
+				c[4][lane] = at(2, 1) * at(3, 3) - at(3, 1) * at(2, 3);
+				c[3][lane] = at(2, 1) * at(3, 2) - at(3, 1) * at(2, 2);
+				c[2][lane] = at(2, 0) * at(3, 3) - at(3, 0) * at(2, 3);
+				c[1][lane] = at(2, 0) * at(3, 2) - at(3, 0) * at(2, 2);
+				c[0][lane] = at(2, 0) * at(3, 1) - at(3, 0) * at(2, 1);
+			}
+		}
+
+		static void determinant4(const number (&s)[6][lanes], const number (&c)[6][lanes], number* result)
+		{
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t lane = 0; lane < lanes; ++lane)
+				result[lane] = s[0][lane] * c[5][lane] - s[1][lane] * c[4][lane] + s[2][lane] * c[3][lane] + s[3][lane] * c[2][lane] - s[4][lane] * c[1][lane] + s[5][lane] * c[0][lane];
+		}
+	};
+
+	template <typename number>
+	constexpr size_t batch_kernel<number>::lanes;
+
+	template <typename number, size_t m, size_t k, size_t n>
+	void multiply_into(batch_matrix<number, m, n>& c, const batch_matrix<number, m, k>& a, const batch_matrix<number, k, n>& b) // C[i] = A[i] * B[i] for every entry, C may be A or B
+	{
+		if (a.size() != b.size())
+			throw matrix_unaligned();
+		c.resize(a.size());
+		batch_kernel<number>::multiply_blocks(c, a, b, 0, a.stride() / batch_lanes<number>::value);
+	}
+
+	template <typename number, size_t m, size_t k, size_t n>
+	void multiply_into(batch_matrix<number, m, n>& c, const batch_matrix<number, m, k>& a, const batch_matrix<number, k, n>& b, const parallel_policy& policy) // Blocks of entries are split across the pool
+	{
+		if (a.size() != b.size())
+			throw matrix_unaligned();
+		c.resize(a.size());
+		policy.get_pool().parallel_for(0, a.stride() / batch_lanes<number>::value, 256, [&](size_t block_begin, size_t block_end)
+		{
+			batch_kernel<number>::multiply_blocks(c, a, b, block_begin, block_end);
+		});
+	}
+
+	template <typename number, size_t m, size_t k, size_t n>
+	batch_matrix<number, m, n> operator*(const batch_matrix<number, m, k>& a, const batch_matrix<number, k, n>& b)
+	{
+		batch_matrix<number, m, n> result;
+		multiply_into(result, a, b);
+		return result;
+	}
+
+	template <typename number, size_t size>
+	void determinant_into(std::vector<number>& result, const batch_matrix<number, size, size>& src) // result[i] = det(src[i])
+	{
+		result.resize(src.size());
+		batch_kernel<number>::determinant_blocks(result, src, 0, src.stride() / batch_lanes<number>::value);
+	}
+
+	template <typename number, size_t size>
+	void determinant_into(std::vector<number>& result, const batch_matrix<number, size, size>& src, const parallel_policy& policy)
+	{
+		result.resize(src.size());
+		policy.get_pool().parallel_for(0, src.stride() / batch_lanes<number>::value, 256, [&](size_t block_begin, size_t block_end)
+		{
+			batch_kernel<number>::determinant_blocks(result, src, block_begin, block_end);
+		});
+	}
+
+	template <typename number, size_t size>
+	void inverse_into(batch_matrix<number, size, size>& result, const batch_matrix<number, size, size>& src) // result[i] = src[i]^-1, result may be src; throws matrix_singular after the pass if any entry is singular
+	{
+		result.resize(src.size());
+		if (!batch_kernel<number>::inverse_blocks(result, src, 0, src.stride() / batch_lanes<number>::value))
+			throw matrix_singular();
+	}
+
+	template <typename number, size_t size>
+	void inverse_into(batch_matrix<number, size, size>& result, const batch_matrix<number, size, size>& src, const parallel_policy& policy)
+	{
+		result.resize(src.size());
+		std::atomic<bool> invertible{true};
+		policy.get_pool().parallel_for(0, src.stride() / batch_lanes<number>::value, 256, [&](size_t block_begin, size_t block_end)
+		{
+			if (!batch_kernel<number>::inverse_blocks(result, src, block_begin, block_end))
+				invertible = false;
+		});
+		if (!invertible)
+			throw matrix_singular();
+	}
+}
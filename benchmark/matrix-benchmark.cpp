@@ -0,0 +1,527 @@
+// Benchmarks of zaoly::matrix, built as a standalone program from this directory, for example
+//   cl /O2 /EHsc /std:c++17 /arch:AVX2 matrix-benchmark.cpp
+//   g++ -O2 -march=native -pthread matrix-benchmark.cpp -o matrix-benchmark
+//
+// Usage: matrix-benchmark [--filter text] [--min-size n] [--max-size n] [--min-time seconds]
+//                         [--json file] [--compare baseline.json] [--threshold fraction]
+//
+// Every case is named operation/type/size and reports ns/op, GFLOP/s and heap allocations per op.
+// --json writes the results, --compare reads an earlier --json file, prints the change of every case
+// present in both and exits with 1 when any case got slower by more than --threshold (default 0.05).
+
+#include "../batch-matrix.hpp"
+#include "../bigint.hpp"
+#include "../iterative-solver.hpp"
+#include "../matrix.hpp"
+#include "../modint.hpp"
+#include "../rational.hpp"
+#include "../rational-vector.hpp"
+#include "../sparse-matrix.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static std::atomic<size_t> allocation_count{};
+
+// The replacements below pair malloc with free correctly, but once GCC inlines them into a new-expression and
+// its matching delete-expression it sees std::free applied to the result of operator new and warns (GCC 11 and later)
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size)
+{
+	++allocation_count;
+	if (void* result = std::malloc(size ? size : 1))
+		return result;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+	std::free(pointer);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+using rational_type = zaoly::rational<long long, unsigned long long>;
+using modint_type = zaoly::modint<long long, 998244353>;
+using big_rational_type = zaoly::rational<zaoly::bigint, zaoly::bigint>;
+
+struct benchmark_options
+{
+	std::string filter;
+	size_t min_size = 4, max_size = 4096;
+	double min_time = 0.2;
+	std::string json_path, compare_path;
+	double threshold = 0.05;
+};
+
+struct benchmark_result
+{
+	std::string name, operation, type;
+	size_t size, iterations;
+	double ns_per_op, gflops, allocs_per_op;
+};
+
+template <typename number>
+struct element_traits;
+
+template <>
+struct element_traits<float>
+{
+	static const char* name() { return "float"; }
+	static float random(std::mt19937& engine) { return std::uniform_real_distribution<float>(-1, 1)(engine); }
+	static constexpr size_t max_product = 4096, max_elimination = 4096; // Largest sizes worth timing for products and for determinant or inverse
+};
+
+template <>
+struct element_traits<double>
+{
+	static const char* name() { return "double"; }
+	static double random(std::mt19937& engine) { return std::uniform_real_distribution<double>(-1, 1)(engine); }
+	static constexpr size_t max_product = 4096, max_elimination = 4096;
+};
+
+template <>
+struct element_traits<rational_type>
+{
+	static const char* name() { return "rational"; }
+	static rational_type random(std::mt19937& engine) { return rational_type(std::uniform_int_distribution<int>(-9, 9)(engine), std::uniform_int_distribution<int>(1, 4)(engine)); }
+	static constexpr size_t max_product = 256, max_elimination = 8; // Bareiss intermediates overflow 64 bits beyond this
+};
+
+template <>
+struct element_traits<big_rational_type>
+{
+	static const char* name() { return "bigrational"; }
+	static big_rational_type random(std::mt19937& engine) { return big_rational_type(std::uniform_int_distribution<int>(-9, 9)(engine), std::uniform_int_distribution<int>(1, 4)(engine)); }
+	static constexpr size_t max_product = 128, max_elimination = 64; // Exact at any size, the limit is only time
+};
+
+template <>
+struct element_traits<modint_type>
+{
+	static const char* name() { return "modint"; }
+	static modint_type random(std::mt19937& engine) { return modint_type(std::uniform_int_distribution<long long>(0, 998244352)(engine)); }
+	static constexpr size_t max_product = 1024, max_elimination = 0; // modint has no modular inverse, so elimination is not meaningful
+};
+
+static const void* volatile sink;
+
+static std::string case_name(const char* operation, const char* type, size_t size)
+{
+	return std::string(operation) + "/" + type + "/" + std::to_string(size);
+}
+
+template <typename function_type>
+benchmark_result measure(const benchmark_options& options, const char* operation, const char* type, size_t size, double flops_per_op, const function_type& func)
+{
+	using clock = std::chrono::steady_clock;
+	func(); // Warm up caches and per-thread scratch buffers
+	size_t iterations = 1;
+	for (;;)
+	{
+		const size_t allocations = allocation_count;
+		const clock::time_point start = clock::now();
+		for (size_t index = 0; index < iterations; ++index)
+			func();
+		const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+		if (elapsed >= options.min_time || iterations >= (size_t(1) << 30))
+		{
+			benchmark_result result;
+			result.name = case_name(operation, type, size);
+			result.operation = operation;
+			result.type = type;
+			result.size = size;
+			result.iterations = iterations;
+			result.ns_per_op = elapsed * 1e9 / iterations;
+			result.gflops = flops_per_op / result.ns_per_op;
+			result.allocs_per_op = double(allocation_count - allocations) / iterations;
+			return result;
+		}
+		iterations = elapsed <= 0 ? iterations * 10 : std::max(iterations * 2, size_t(iterations * options.min_time * 1.2 / elapsed));
+	}
+}
+
+class benchmark_session // Skips cases the filter rejects, prints each result as it finishes and collects them
+{
+public:
+	benchmark_session(const benchmark_options& options) : _options(options) {}
+
+	bool selected(const char* operation, const char* type, size_t size) const
+	{
+		return _options.filter.empty() || case_name(operation, type, size).find(_options.filter) != std::string::npos;
+	}
+
+	template <typename function_type>
+	void run(const char* operation, const char* type, size_t size, double flops_per_op, const function_type& func)
+	{
+		if (!selected(operation, type, size))
+			return;
+		const benchmark_result result = measure(_options, operation, type, size, flops_per_op, func);
+		std::printf("%-28s %14.1f ns/op %10.3f GFLOP/s %10.2f allocs/op\n", result.name.c_str(), result.ns_per_op, result.gflops, result.allocs_per_op);
+		std::fflush(stdout);
+		_results.push_back(result);
+	}
+
+	const benchmark_options& options() const
+	{
+		return _options;
+	}
+
+	const std::vector<benchmark_result>& results() const
+	{
+		return _results;
+	}
+
+private:
+	const benchmark_options& _options;
+	std::vector<benchmark_result> _results;
+};
+
+template <typename number>
+zaoly::matrix<number> random_matrix(size_t size, std::mt19937& engine, bool dominant)
+{
+	zaoly::matrix<number> result(size, size);
+	for (size_t index = 0; index < size * size; ++index)
+		result.data()[index] = element_traits<number>::random(engine);
+	if (dominant) // Keeps elimination away from singular or badly conditioned matrices
+		for (size_t index = 0; index < size; ++index)
+			result.data()[index * size + index] += number(int(size));
+	return result;
+}
+
+template <typename number>
+void run_type(benchmark_session& session)
+{
+	const benchmark_options& options = session.options();
+	using traits = element_traits<number>;
+	std::mt19937 engine(42);
+	for (size_t size = options.min_size; size <= options.max_size; size *= 2)
+	{
+		const double n = double(size);
+		if (size <= traits::max_product)
+		{
+			const zaoly::matrix<number> a = random_matrix<number>(size, engine, false), b = random_matrix<number>(size, engine, false);
+			zaoly::matrix<number> c(size, size);
+			session.run("multiply", traits::name(), size, 2 * n * n * n, [&] { c = a * b; sink = c.data(); });
+			session.run("multiply_into", traits::name(), size, 2 * n * n * n, [&] { zaoly::multiply_into(c, a, b); sink = c.data(); });
+			session.run("transpose", traits::name(), size, 0, [&] { zaoly::transpose_into(c, a); sink = c.data(); });
+			session.run("add", traits::name(), size, n * n, [&] { c = a + b; sink = c.data(); });
+		}
+		if (size <= traits::max_elimination)
+		{
+			const zaoly::matrix<number> a = random_matrix<number>(size, engine, true);
+			number determinant{};
+			session.run("determinant", traits::name(), size, 2 * n * n * n / 3, [&] { determinant = a.determinant(); sink = &determinant; });
+			zaoly::matrix<number> inverse(size, size);
+			session.run("inverse", traits::name(), size, 2 * n * n * n, [&] { inverse = a.inverse(); sink = inverse.data(); });
+		}
+	}
+}
+
+template <typename number>
+void run_batch(benchmark_session& session) // Batches of 4x4 matrices, size is the number of entries
+{
+	const benchmark_options& options = session.options();
+	using traits = element_traits<number>;
+	std::mt19937 engine(42);
+	const std::string type = std::string(traits::name()) + "4x4";
+	for (size_t size = std::max<size_t>(options.min_size, 64); size <= options.max_size * 256; size *= 8)
+	{
+		const double n = double(size);
+		zaoly::batch_matrix<number, 4, 4> a(size), b(size), c(size);
+		for (size_t index = 0; index < size; ++index)
+			for (size_t row_index = 0; row_index < 4; ++row_index)
+				for (size_t column_index = 0; column_index < 4; ++column_index)
+				{
+					a(index, row_index, column_index) = traits::random(engine) + (row_index == column_index ? number(4) : number(0));
+					b(index, row_index, column_index) = traits::random(engine);
+				}
+		std::vector<number> determinants;
+		session.run("batch_multiply", type.c_str(), size, 128 * n, [&] { zaoly::multiply_into(c, a, b); sink = c.data(); });
+		session.run("batch_determinant", type.c_str(), size, 0, [&] { zaoly::determinant_into(determinants, a); sink = determinants.data(); });
+		session.run("batch_inverse", type.c_str(), size, 0, [&] { zaoly::inverse_into(c, a); sink = c.data(); });
+	}
+}
+
+template <typename number>
+void run_scalar(benchmark_session& session) // Rational arithmetic on one value at a time, size is the number of terms
+{
+	const benchmark_options& options = session.options();
+	using traits = element_traits<number>;
+	std::mt19937 engine(42);
+	for (size_t size = std::max<size_t>(options.min_size, 16); size <= options.max_size; size *= 4)
+	{
+		const double n = double(size);
+		std::vector<number> a(size), b(size);
+		for (size_t index = 0; index < size; ++index)
+		{
+			a[index] = traits::random(engine);
+			b[index] = traits::random(engine);
+		}
+		number result{};
+		session.run("scalar_sum", traits::name(), size, n, [&] { result = 0; for (const number& term : a) result += term; sink = &result; }); // Denominators stay small, so this measures the overhead of the integer type
+		session.run("scalar_accumulate", traits::name(), size, n, [&] { zaoly::rational_accumulator<typename number::dividend_type, typename number::divisor_type> total; for (const number& term : a) total += term; result = total.value(); sink = &result; });
+		if (session.selected("scalar_root", traits::name(), size)) // Square roots of perfect squares, exact
+		{
+			std::vector<number> squares(size);
+			for (size_t index = 0; index < size; ++index)
+				squares[index] = a[index] * a[index];
+			const number half(1, 2);
+			session.run("scalar_root", traits::name(), size, 0, [&] { for (const number& term : squares) result = term ^ half; sink = &result; });
+		}
+		session.run("scalar_dot", traits::name(), size, 2 * n, [&] { result = 0; for (size_t index = 0; index < size; ++index) result += a[index] * b[index]; sink = &result; });
+		std::vector<char> text(size * 128);
+		zaoly::rational_writer writer(text.data(), text.size());
+		for (const number& term : a)
+			writer.write(term);
+		std::vector<number> parsed;
+		parsed.reserve(size);
+		session.run("scalar_format", traits::name(), size, 0, [&] { writer.clear(); for (const number& term : a) writer.write(term); sink = writer.data(); });
+		session.run("scalar_parse", traits::name(), size, 0, [&] { parsed.clear(); zaoly::parse_rationals(writer.data(), writer.data() + writer.size(), parsed); sink = parsed.data(); });
+	}
+}
+
+static void run_vector(benchmark_session& session) // rational_vector against a std::vector of rationals, size is the number of entries
+{
+	const benchmark_options& options = session.options();
+	using traits = element_traits<rational_type>;
+	std::mt19937 engine(42);
+	for (size_t size = std::max<size_t>(options.min_size, 16); size <= options.max_size; size *= 4)
+	{
+		const double n = double(size);
+		std::vector<rational_type> a(size), b(size), c(size);
+		for (size_t index = 0; index < size; ++index)
+		{
+			a[index] = traits::random(engine);
+			b[index] = traits::random(engine);
+		}
+		const zaoly::rational_vector<long long, unsigned long long> soa_a(a), soa_b(b);
+		zaoly::rational_vector<long long, unsigned long long> soa_c(size);
+		rational_type result{};
+		session.run("scalar_add", traits::name(), size, n, [&] { for (size_t index = 0; index < size; ++index) c[index] = a[index] + b[index]; sink = c.data(); });
+		session.run("vector_add", traits::name(), size, n, [&] { zaoly::add_into(soa_c, soa_a, soa_b); sink = soa_c.dividends(); });
+		session.run("scalar_multiply", traits::name(), size, n, [&] { for (size_t index = 0; index < size; ++index) c[index] = a[index] * b[index]; sink = c.data(); });
+		session.run("vector_multiply", traits::name(), size, n, [&] { zaoly::multiply_into(soa_c, soa_a, soa_b); sink = soa_c.dividends(); });
+		session.run("vector_sum", traits::name(), size, n, [&] { result = soa_a.sum(); sink = &result; });
+	}
+}
+
+static void run_bigint(benchmark_session& session) // Operand length in 32-bit limbs, schoolbook below bigint::karatsuba_threshold
+{
+	const benchmark_options& options = session.options();
+	std::mt19937 engine(42);
+	const auto random_bigint = [&](size_t limbs)
+	{
+		zaoly::bigint result;
+		for (size_t index = 0; index < limbs; ++index)
+			result = (result << 32) + zaoly::bigint(std::uint32_t(engine()) | 1);
+		return result;
+	};
+	for (size_t size = std::max<size_t>(options.min_size, 2); size <= options.max_size; size *= 4)
+	{
+		const zaoly::bigint a = random_bigint(size), b = random_bigint(size);
+		zaoly::bigint result;
+		session.run("bigint_multiply", "bigint", size, 0, [&] { result = a * b; sink = &result; });
+		session.run("bigint_divide", "bigint", size, 0, [&] { result = (a * b + a) / b; sink = &result; });
+		session.run("bigint_gcd", "bigint", size, 0, [&] { result = greatest_common_divisor(a, b); sink = &result; });
+	}
+}
+
+static zaoly::sparse_matrix<double> laplacian(size_t side) // Five-point Laplacian on a side x side grid, symmetric positive definite
+{
+	const size_t n = side * side;
+	std::vector<zaoly::sparse_entry<double>> entries;
+	for (size_t row = 0; row < side; ++row)
+		for (size_t column = 0; column < side; ++column)
+		{
+			const size_t index = row * side + column;
+			entries.push_back({ index, index, 4.0 });
+			if (row > 0)
+				entries.push_back({ index, index - side, -1.0 });
+			if (row + 1 < side)
+				entries.push_back({ index, index + side, -1.0 });
+			if (column > 0)
+				entries.push_back({ index, index - 1, -1.0 });
+			if (column + 1 < side)
+				entries.push_back({ index, index + 1, -1.0 });
+		}
+	return zaoly::sparse_matrix<double>(n, n, std::move(entries));
+}
+
+static void run_sparse(benchmark_session& session) // Five-point Laplacian, size is the side of the grid
+{
+	const benchmark_options& options = session.options();
+	for (size_t size = options.min_size; size <= std::min<size_t>(options.max_size, 1024); size *= 2)
+	{
+		const zaoly::sparse_matrix<double> a = laplacian(size);
+		const std::vector<double> x(size * size, 1.0);
+		std::vector<double> y;
+		const double nonzeros = double(5 * size * size - 4 * size);
+		session.run("sparse_multiply_vector", "double", size, 2 * nonzeros, [&] { zaoly::multiply_into(y, a, x); sink = y.data(); });
+		if (size <= 256)
+		{
+			zaoly::sparse_matrix<double> product = a;
+			session.run("sparse_multiply", "double", size, 0, [&] { product = a * a; sink = &product; });
+		}
+	}
+}
+
+static void run_solver(benchmark_session& session) // Iterative solves of the five-point Laplacian from a zero start, size is the side of the grid
+{
+	const benchmark_options& options = session.options();
+	for (size_t size = options.min_size; size <= std::min<size_t>(options.max_size, 128); size *= 2)
+	{
+		const zaoly::sparse_matrix<double> a = laplacian(size);
+		const std::vector<double> b(size * size, 1.0);
+		const zaoly::jacobi_preconditioner<double> jacobi(a);
+		const zaoly::incomplete_lu_preconditioner<double> ilu(a);
+		std::vector<double> x;
+		zaoly::iterative_result result;
+		session.run("cg_jacobi", "double", size, 0, [&] { x.assign(b.size(), 0.0); result = zaoly::conjugate_gradient(a, b, x, jacobi); sink = x.data(); });
+		session.run("bicgstab_ilu0", "double", size, 0, [&] { x.assign(b.size(), 0.0); result = zaoly::bicgstab(a, b, x, ilu); sink = x.data(); });
+		session.run("gmres_ilu0", "double", size, 0, [&] { x.assign(b.size(), 0.0); result = zaoly::gmres(a, b, x, ilu); sink = x.data(); });
+	}
+}
+
+static void write_json(const std::string& path, const std::vector<benchmark_result>& results) // One case per line, which is all read_json relies on
+{
+	std::ofstream out(path);
+	out << "{\n\t\"benchmarks\": [\n";
+	for (size_t index = 0; index < results.size(); ++index)
+	{
+		const benchmark_result& result = results[index];
+		out << "\t\t{\"name\": \"" << result.name << "\", \"operation\": \"" << result.operation << "\", \"type\": \"" << result.type
+			<< "\", \"size\": " << result.size << ", \"iterations\": " << result.iterations << ", \"ns_per_op\": " << result.ns_per_op
+			<< ", \"gflops\": " << result.gflops << ", \"allocs_per_op\": " << result.allocs_per_op << "}" << (index + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "\t]\n}\n";
+}
+
+static std::map<std::string, double> read_json(const std::string& path) // Name to ns/op
+{
+	std::map<std::string, double> result;
+	std::ifstream in(path);
+	if (!in)
+	{
+		std::fprintf(stderr, "Cannot open %s\n", path.c_str());
+		std::exit(2);
+	}
+	std::string line;
+	while (std::getline(in, line))
+	{
+		const size_t name = line.find("\"name\": \""), ns = line.find("\"ns_per_op\": ");
+		if (name == std::string::npos || ns == std::string::npos)
+			continue;
+		const size_t name_begin = name + 9, name_end = line.find('"', name_begin);
+		result[line.substr(name_begin, name_end - name_begin)] = std::strtod(line.c_str() + ns + 13, nullptr);
+	}
+	return result;
+}
+
+static int compare(const benchmark_options& options, const std::vector<benchmark_result>& results)
+{
+	const std::map<std::string, double> baseline = read_json(options.compare_path);
+	int regressions = 0;
+	std::printf("\n%-28s %14s %14s %9s\n", "case", "baseline ns", "current ns", "change");
+	for (const benchmark_result& result : results)
+	{
+		const auto found = baseline.find(result.name);
+		if (found == baseline.end())
+			continue;
+		const double change = result.ns_per_op / found->second - 1;
+		const bool regressed = change > options.threshold;
+		regressions += regressed;
+		std::printf("%-28s %14.1f %14.1f %+8.1f%%%s\n", result.name.c_str(), found->second, result.ns_per_op, change * 100, regressed ? "  REGRESSION" : "");
+	}
+	std::printf("%d regression(s) over %.1f%%\n", regressions, options.threshold * 100);
+	return regressions > 0 ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+	benchmark_options options;
+	for (int index = 1; index < argc; ++index)
+	{
+		const std::string arg = argv[index];
+		const char* value = index + 1 < argc ? argv[index + 1] : nullptr;
+		if (value == nullptr)
+		{
+			std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+			return 2;
+		}
+		++index;
+		if (arg == "--filter")
+			options.filter = value;
+		else if (arg == "--min-size")
+			options.min_size = std::max<size_t>(1, std::strtoul(value, nullptr, 10));
+		else if (arg == "--max-size")
+			options.max_size = std::strtoul(value, nullptr, 10);
+		else if (arg == "--min-time")
+			options.min_time = std::strtod(value, nullptr);
+		else if (arg == "--json")
+			options.json_path = value;
+		else if (arg == "--compare")
+			options.compare_path = value;
+		else if (arg == "--threshold")
+			options.threshold = std::strtod(value, nullptr);
+		else
+		{
+			std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+			return 2;
+		}
+	}
+	benchmark_session session(options);
+	run_type<float>(session);
+	run_type<double>(session);
+	run_type<rational_type>(session);
+	run_type<modint_type>(session);
+	run_type<big_rational_type>(session);
+	run_scalar<rational_type>(session);
+	run_scalar<big_rational_type>(session);
+	run_vector(session);
+	run_bigint(session);
+	run_sparse(session);
+	run_solver(session);
+	run_batch<float>(session);
+	run_batch<double>(session);
+	if (!options.json_path.empty())
+		write_json(options.json_path, session.results());
+	if (!options.compare_path.empty())
+		return compare(options, session.results());
+	return 0;
+}
@@ -0,0 +1,963 @@
+#pragma once
+
+#include "rational.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace zaoly
+{
+	class bigint_divide_by_zero : std::domain_error
+	{
+	public:
+		bigint_divide_by_zero() : std::domain_error("Bigint division by zero") {}
+	};
+
+	class bigint_format_error : std::invalid_argument
+	{
+	public:
+		bigint_format_error() : std::invalid_argument("Bigint format error") {}
+	};
+
+	class bigint // Arbitrary-precision signed integer, usable as d_type and s_type of rational: sign and magnitude in 32-bit limbs, least significant first
+	{
+	public:
+		using limb = std::uint32_t;
+		static constexpr size_t inline_limbs = 4; // Values below 2^128 never touch the heap
+		static constexpr size_t karatsuba_threshold = 32; // Limbs of the shorter factor from which multiplication splits in three half-size products
+
+		bigint() noexcept : _inline{} {}
+
+		template <typename integer, typename = typename std::enable_if<std::is_integral<integer>::value>::type>
+		bigint(integer value) noexcept : _inline{}
+		{
+			_negative = std::is_signed<integer>::value && value < integer(0);
+			std::uint64_t magnitude = _negative ? std::uint64_t(0) - std::uint64_t(value) : std::uint64_t(value);
+			for (; magnitude != 0; magnitude >>= 32)
+				_inline[_size++] = limb(magnitude);
+		}
+
+		explicit bigint(const char* text) : _inline{} // Decimal with an optional sign
+		{
+			const char* cursor = text;
+			const bool negative = *cursor == '-';
+			if (*cursor == '-' || *cursor == '+')
+				++cursor;
+			if (*cursor == '\0')
+				throw bigint_format_error();
+			for (; *cursor != '\0'; ++cursor)
+			{
+				if (*cursor < '0' || *cursor > '9')
+					throw bigint_format_error();
+				multiply_add(10, limb(*cursor - '0'));
+			}
+			_negative = negative && _size > 0;
+		}
+
+		explicit bigint(const std::string& text) : bigint(text.c_str()) {}
+
+		bigint(const bigint& other) : _inline{}
+		{
+			assign(other);
+		}
+
+		bigint(bigint&& other) noexcept : _inline{}
+		{
+			steal(other);
+		}
+
+		~bigint()
+		{
+			release();
+		}
+
+		bigint& operator=(const bigint& other)
+		{
+			if (this != &other)
+				assign(other);
+			return *this;
+		}
+
+		bigint& operator=(bigint&& other) noexcept
+		{
+			if (this != &other)
+			{
+				release();
+				steal(other);
+			}
+			return *this;
+		}
+
+		size_t size() const // Limbs in use, 0 for zero
+		{
+			return _size;
+		}
+
+		const limb* limbs() const
+		{
+			return data();
+		}
+
+		bool negative() const
+		{
+			return _negative;
+		}
+
+		size_t bit_length() const // Bits of the magnitude
+		{
+			return _size == 0 ? 0 : 32 * _size - leading_zeros(data()[_size - 1]);
+		}
+
+		explicit operator bool() const
+		{
+			return _size != 0;
+		}
+
+		template <typename integer, typename = typename std::enable_if<std::is_integral<integer>::value && !std::is_same<integer, bool>::value>::type>
+		explicit operator integer() const // The low bits, like a conversion between built-in integers
+		{
+			const std::uint64_t magnitude = low_bits();
+			return integer(_negative ? std::uint64_t(0) - magnitude : magnitude);
+		}
+
+		explicit operator double() const
+		{
+			double result = 0;
+			for (size_t index = _size; index-- > 0;)
+				result = result * 4294967296.0 + data()[index];
+			return _negative ? -result : result;
+		}
+
+		std::string to_string() const
+		{
+			if (_size == 0)
+				return "0";
+			std::vector<limb> work(data(), data() + _size), chunks; // Base 10^9 digits, least significant first
+			for (size_t size = _size; size > 0;)
+			{
+				chunks.push_back(divide_small(work.data(), size, 1000000000, work.data()));
+				while (size > 0 && work[size - 1] == 0)
+					--size;
+			}
+			std::string result = _negative ? "-" : "";
+			result += std::to_string(chunks.back());
+			for (size_t index = chunks.size() - 1; index-- > 0;)
+			{
+				char digits[9];
+				for (size_t digit = 9; digit-- > 0; chunks[index] /= 10)
+					digits[digit] = char('0' + chunks[index] % 10);
+				result.append(digits, 9);
+			}
+			return result;
+		}
+
+		bigint operator+() const
+		{
+			return *this;
+		}
+
+		bigint operator-() const
+		{
+			bigint result = *this;
+			result._negative = !_negative && _size > 0;
+			return result;
+		}
+
+		bigint& operator++()
+		{
+			return *this += 1;
+		}
+
+		bigint operator++(int)
+		{
+			bigint result = *this;
+			*this += 1;
+			return result;
+		}
+
+		bigint& operator--()
+		{
+			return *this -= 1;
+		}
+
+		bigint operator--(int)
+		{
+			bigint result = *this;
+			*this -= 1;
+			return result;
+		}
+
+		bigint& operator+=(const bigint& other)
+		{
+			add(other, other._negative);
+			return *this;
+		}
+
+		bigint& operator-=(const bigint& other)
+		{
+			add(other, !other._negative);
+			return *this;
+		}
+
+		bigint& operator*=(const bigint& other)
+		{
+			return *this = *this * other;
+		}
+
+		bigint& operator/=(const bigint& other)
+		{
+			bigint quotient;
+			divide(*this, other, &quotient, nullptr);
+			return *this = std::move(quotient);
+		}
+
+		bigint& operator%=(const bigint& other)
+		{
+			bigint remainder;
+			divide(*this, other, nullptr, &remainder);
+			return *this = std::move(remainder);
+		}
+
+		bigint& operator<<=(size_t bits) // Shifts act on the magnitude and keep the sign
+		{
+			if (_size == 0)
+				return *this;
+			const size_t limb_shift = bits / 32, bit_shift = bits % 32;
+			const limb spill = bit_shift == 0 ? 0 : limb(data()[_size - 1] >> (32 - bit_shift)); // Bits pushed out of the top limb
+			const size_t size = _size + limb_shift + (spill != 0 ? 1 : 0);
+			reserve(size);
+			limb* limbs = data();
+			for (size_t index = _size; index-- > 0;)
+			{
+				const limb carried = index == 0 || bit_shift == 0 ? 0 : limb(limbs[index - 1] >> (32 - bit_shift));
+				limbs[index + limb_shift] = limb(limbs[index] << bit_shift) | carried;
+			}
+			if (spill != 0)
+				limbs[size - 1] = spill;
+			std::fill(limbs, limbs + limb_shift, limb(0));
+			_size = std::uint32_t(size);
+			return *this;
+		}
+
+		bigint& operator>>=(size_t bits) // Truncates toward zero, unlike >> on negative built-in integers
+		{
+			const size_t limb_shift = bits / 32, bit_shift = bits % 32;
+			if (limb_shift >= _size)
+				return *this = bigint();
+			limb* limbs = data();
+			for (size_t index = 0; index + limb_shift < _size; ++index)
+			{
+				const limb high = index + limb_shift + 1 < _size ? limbs[index + limb_shift + 1] : 0;
+				limbs[index] = limb(limbs[index + limb_shift] >> bit_shift) | (bit_shift == 0 ? 0 : limb(high << (32 - bit_shift)));
+			}
+			_size -= limb_shift;
+			trim();
+			return *this;
+		}
+
+		bigint& operator&=(const bigint& other) // Bitwise operators act on the magnitudes, the result is non-negative
+		{
+			_size = std::min(_size, other._size);
+			for (size_t index = 0; index < _size; ++index)
+				data()[index] &= other.data()[index];
+			_negative = false;
+			trim();
+			return *this;
+		}
+
+		bigint& operator|=(const bigint& other)
+		{
+			reserve(other._size);
+			limb* limbs = data();
+			const limb* other_limbs = other.data();
+			for (size_t index = _size; index < other._size; ++index)
+				limbs[index] = 0;
+			for (size_t index = 0; index < other._size; ++index)
+				limbs[index] |= other_limbs[index];
+			_size = std::max(_size, other._size);
+			_negative = false;
+			return *this;
+		}
+
+		friend bigint operator+(const bigint& a, const bigint& b)
+		{
+			bigint result = a;
+			return result += b;
+		}
+
+		friend bigint operator-(const bigint& a, const bigint& b)
+		{
+			bigint result = a;
+			return result -= b;
+		}
+
+		friend bigint operator*(const bigint& a, const bigint& b)
+		{
+			bigint result;
+			if (a._size == 0 || b._size == 0)
+				return result;
+			if (a._size + b._size <= 2) // Both below 2^32
+			{
+				const std::uint64_t product = std::uint64_t(a.data()[0]) * b.data()[0];
+				result._inline[0] = limb(product);
+				result._inline[1] = limb(product >> 32);
+				result._size = 2;
+			}
+			else if (a._size + b._size <= inline_limbs + 1) // The product may still fit inline once its top limb is trimmed
+			{
+				limb product[inline_limbs + 1];
+				multiply_limbs(a.data(), a._size, b.data(), b._size, product);
+				const size_t size = product[a._size + b._size - 1] == 0 ? a._size + b._size - 1 : a._size + b._size;
+				result.reserve(size);
+				std::copy(product, product + size, result.data());
+				result._size = std::uint32_t(size);
+			}
+			else
+			{
+				result.reserve(a._size + b._size);
+				multiply_limbs(a.data(), a._size, b.data(), b._size, result.data());
+				result._size = a._size + b._size;
+			}
+			result._negative = a._negative != b._negative;
+			result.trim();
+			return result;
+		}
+
+		friend bigint operator/(const bigint& a, const bigint& b) // Truncates toward zero like built-in integers
+		{
+			bigint quotient;
+			divide(a, b, &quotient, nullptr);
+			return quotient;
+		}
+
+		friend bigint operator%(const bigint& a, const bigint& b) // Takes the sign of the dividend like built-in integers
+		{
+			bigint remainder;
+			divide(a, b, nullptr, &remainder);
+			return remainder;
+		}
+
+		friend bigint operator<<(bigint a, size_t bits)
+		{
+			return a <<= bits;
+		}
+
+		friend bigint operator>>(bigint a, size_t bits)
+		{
+			return a >>= bits;
+		}
+
+		friend bigint operator&(bigint a, const bigint& b)
+		{
+			return a &= b;
+		}
+
+		friend bigint operator|(bigint a, const bigint& b)
+		{
+			return a |= b;
+		}
+
+		friend bool operator==(const bigint& a, const bigint& b)
+		{
+			return compare(a, b) == 0;
+		}
+
+		friend bool operator!=(const bigint& a, const bigint& b)
+		{
+			return compare(a, b) != 0;
+		}
+
+		friend bool operator<(const bigint& a, const bigint& b)
+		{
+			return compare(a, b) < 0;
+		}
+
+		friend bool operator>(const bigint& a, const bigint& b)
+		{
+			return compare(a, b) > 0;
+		}
+
+		friend bool operator<=(const bigint& a, const bigint& b)
+		{
+			return compare(a, b) <= 0;
+		}
+
+		friend bool operator>=(const bigint& a, const bigint& b)
+		{
+			return compare(a, b) >= 0;
+		}
+
+		friend bigint abs(bigint num)
+		{
+			num._negative = false;
+			return num;
+		}
+
+		friend bigint greatest_common_divisor(bigint a, bigint b) // Lehmer's algorithm: Euclid steps on the leading 32 bits, applied to the full values as one cofactor matrix per 32 bits of progress
+		{
+			a._negative = b._negative = false;
+			if (compare_limbs(a.data(), a._size, b.data(), b._size) < 0)
+				std::swap(a, b);
+			while (b._size > 2)
+			{
+				const size_t position = a.bit_length() - 32;
+				std::int64_t x = a.bits_at(position), y = b.bits_at(position), A = 1, B = 0, C = 0, D = 1;
+				while (y + C != 0 && y + D != 0)
+				{
+					const std::int64_t q = (x + A) / (y + C);
+					if (q != (x + B) / (y + D))
+						break;
+					std::int64_t t = A - q * C;
+					A = C;
+					C = t;
+					t = B - q * D;
+					B = D;
+					D = t;
+					t = x - q * y;
+					x = y;
+					y = t;
+				}
+				if (B == 0) // The leading bits could not tell the quotient, one full division step
+				{
+					a %= b;
+					std::swap(a, b);
+				}
+				else
+					apply_cofactors(a, b, A, B, C, D);
+			}
+			if (b._size == 0)
+				return a;
+			if (a._size > 2)
+				a %= b;
+			return bigint(greatest_common_divisor(a.low_bits(), b.low_bits()));
+		}
+
+		// Overflow checks of rational's checked mode, a bigint never overflows
+		friend bool add_overflow(const bigint& a, const bigint& b, bigint& result)
+		{
+			result = a + b;
+			return false;
+		}
+
+		friend bool subtract_overflow(const bigint& a, const bigint& b, bigint& result)
+		{
+			result = a - b;
+			return false;
+		}
+
+		friend bool multiply_overflow(const bigint& a, const bigint& b, bigint& result)
+		{
+			result = a * b;
+			return false;
+		}
+
+		friend to_chars_result to_chars(char* first, char* last, const bigint& num) // Decimal like std::to_chars, allocation-free below 2^64
+		{
+			if (num._size <= 2)
+			{
+				if (num._negative)
+				{
+					if (first == last)
+						return { last, std::errc::value_too_large };
+					*first++ = '-';
+				}
+				return write_integer(first, last, num.low_bits(), std::true_type());
+			}
+			const std::string text = num.to_string();
+			if (size_t(last - first) < text.size())
+				return { last, std::errc::value_too_large };
+			std::memcpy(first, text.data(), text.size());
+			return { first + text.size(), std::errc() };
+		}
+
+		friend from_chars_result from_chars(const char* first, const char* last, bigint& num) // An optional '-' and decimal digits like std::from_chars, never out of range
+		{
+			const bool negative = first != last && *first == '-';
+			const char* cursor = first + (negative ? 1 : 0);
+			const char* const digits = cursor;
+			bigint result;
+			while (cursor != last && unsigned(*cursor - '0') < 10) // Nine digits per multiply-add
+			{
+				limb chunk = 0, factor = 1;
+				for (; cursor != last && unsigned(*cursor - '0') < 10 && factor != 1000000000; ++cursor)
+				{
+					chunk = chunk * 10 + limb(*cursor - '0');
+					factor *= 10;
+				}
+				result.multiply_add(factor, chunk);
+			}
+			if (cursor == digits)
+				return { first, std::errc::invalid_argument };
+			result._negative = negative && result._size > 0;
+			num = std::move(result);
+			return { cursor, std::errc() };
+		}
+
+		friend std::ostream& operator<<(std::ostream& os, const bigint& num)
+		{
+			return os << num.to_string();
+		}
+
+		friend std::istream& operator>>(std::istream& is, bigint& num) // Reads an optional sign and decimal digits, stops before any other character
+		{
+			std::istream::sentry sentry(is);
+			if (!sentry)
+				return is;
+			bigint result;
+			bool negative = false, digits = false;
+			if (is.peek() == '-' || is.peek() == '+')
+				negative = is.get() == '-';
+			for (int next = is.peek(); next >= '0' && next <= '9'; next = is.peek())
+			{
+				result.multiply_add(10, limb(is.get() - '0'));
+				digits = true;
+			}
+			if (!digits)
+			{
+				is.setstate(std::ios::failbit);
+				return is;
+			}
+			result._negative = negative && result._size > 0;
+			num = std::move(result);
+			if (is.peek() == std::char_traits<char>::eof())
+				is.clear(is.rdstate() & ~std::ios::failbit);
+			return is;
+		}
+
+	private:
+		std::uint32_t _size = 0, _capacity = inline_limbs;
+		bool _negative = false;
+		union
+		{
+			limb _inline[inline_limbs];
+			limb* _heap;
+		};
+
+		limb* data()
+		{
+			return _capacity > inline_limbs ? _heap : _inline;
+		}
+
+		const limb* data() const
+		{
+			return _capacity > inline_limbs ? _heap : _inline;
+		}
+
+		void reserve(size_t capacity) // Keeps the limbs in use
+		{
+			if (capacity <= _capacity)
+				return;
+			const size_t new_capacity = std::max<size_t>(capacity, 2 * size_t(_capacity));
+			limb* new_data = new limb[new_capacity];
+			std::copy(data(), data() + _size, new_data);
+			release();
+			_heap = new_data;
+			_capacity = std::uint32_t(new_capacity);
+		}
+
+		void release()
+		{
+			if (_capacity > inline_limbs)
+				delete[] _heap;
+			_capacity = inline_limbs;
+		}
+
+		void assign(const bigint& other)
+		{
+			reserve(other._size);
+			std::copy(other.data(), other.data() + other._size, data());
+			_size = other._size;
+			_negative = other._negative;
+		}
+
+		void steal(bigint& other) noexcept // Takes the heap block or copies the inline limbs, and leaves other zero
+		{
+			_size = other._size;
+			_capacity = other._capacity;
+			_negative = other._negative;
+			if (other._capacity > inline_limbs)
+				_heap = other._heap;
+			else
+				std::copy(other._inline, other._inline + inline_limbs, _inline);
+			other._size = 0;
+			other._capacity = inline_limbs;
+			other._negative = false;
+		}
+
+		void trim()
+		{
+			const limb* limbs = data();
+			while (_size > 0 && limbs[_size - 1] == 0)
+				--_size;
+			if (_size == 0)
+				_negative = false;
+		}
+
+		std::uint64_t low_bits() const
+		{
+			return _size == 0 ? 0 : _size == 1 ? data()[0] : std::uint64_t(data()[1]) << 32 | data()[0];
+		}
+
+		std::int64_t bits_at(size_t position) const // The 32 bits of the magnitude from the given bit upward
+		{
+			const size_t index = position / 32, shift = position % 32;
+			const std::uint64_t low = index < _size ? data()[index] : 0, high = index + 1 < _size ? data()[index + 1] : 0;
+			return std::int64_t(((high << 32 | low) >> shift) & 0xFFFFFFFF);
+		}
+
+		void multiply_add(limb factor, limb addend) // *this = *this * factor + addend on the magnitude
+		{
+			limb* limbs = data();
+			std::uint64_t carry = addend;
+			for (size_t index = 0; index < _size; ++index)
+			{
+				carry += std::uint64_t(limbs[index]) * factor;
+				limbs[index] = limb(carry);
+				carry >>= 32;
+			}
+			if (carry != 0) // Only a carry out of the top limb grows the value
+			{
+				reserve(_size + 1);
+				data()[_size++] = limb(carry);
+			}
+			trim();
+		}
+
+		void add(const bigint& other, bool other_negative) // *this += other with the given sign, other may be *this
+		{
+			if (_size <= 1 && other._size <= 1) // Both below 2^32, the signed sum fits in 64 bits
+			{
+				limb* limbs = data();
+				const std::int64_t left = _size == 0 ? 0 : std::int64_t(limbs[0]), right = other._size == 0 ? 0 : std::int64_t(other.data()[0]);
+				const std::int64_t sum = (_negative ? -left : left) + (other_negative ? -right : right);
+				const std::uint64_t magnitude = sum < 0 ? std::uint64_t(-sum) : std::uint64_t(sum);
+				limbs[0] = limb(magnitude);
+				limbs[1] = limb(magnitude >> 32);
+				_size = magnitude == 0 ? 0 : magnitude >> 32 == 0 ? 1 : 2;
+				_negative = sum < 0;
+				return;
+			}
+			if (_negative == other_negative)
+			{
+				const size_t size = std::max(_size, other._size);
+				reserve(size);
+				limb* limbs = data();
+				const limb* other_limbs = other.data();
+				const limb carry = _size >= other._size ? add_limbs(limbs, _size, other_limbs, other._size, limbs) : add_limbs(other_limbs, other._size, limbs, _size, limbs);
+				_size = std::uint32_t(size);
+				if (carry != 0) // Only a carry out of the top limb grows the value
+				{
+					reserve(size + 1);
+					data()[_size++] = carry;
+				}
+				return;
+			}
+			const int order = compare_limbs(data(), _size, other.data(), other._size);
+			if (order == 0)
+			{
+				_size = 0;
+				_negative = false;
+				return;
+			}
+			if (order > 0)
+				subtract_limbs(data(), _size, other.data(), other._size, data());
+			else
+			{
+				reserve(other._size);
+				subtract_limbs(other.data(), other._size, data(), _size, data());
+				_size = other._size;
+				_negative = other_negative;
+			}
+			trim();
+		}
+
+		static void apply_cofactors(bigint& a, bigint& b, std::int64_t A, std::int64_t B, std::int64_t C, std::int64_t D) // (a, b) = (A * a + B * b, C * a + D * b) in place, for a Lehmer step: each row has cofactors of opposite signs below 2^32, and both results are below b
+		{
+			limb* a_limbs = a.data(), * b_limbs = b.data();
+			std::uint64_t a_carry = 0, a_borrow = 0, b_carry = 0, b_borrow = 0;
+			for (size_t index = 0; index < a._size; ++index)
+			{
+				const limb x = a_limbs[index], y = index < b._size ? b_limbs[index] : 0;
+				const limb next_a = B <= 0 ? combine_limb(std::uint64_t(A), x, std::uint64_t(-B), y, a_carry, a_borrow) : combine_limb(std::uint64_t(B), y, std::uint64_t(-A), x, a_carry, a_borrow);
+				const limb next_b = D <= 0 ? combine_limb(std::uint64_t(C), x, std::uint64_t(-D), y, b_carry, b_borrow) : combine_limb(std::uint64_t(D), y, std::uint64_t(-C), x, b_carry, b_borrow);
+				a_limbs[index] = next_a;
+				if (index < b._size)
+					b_limbs[index] = next_b;
+			}
+			a._size = b._size;
+			a.trim();
+			b.trim();
+		}
+
+		static limb combine_limb(std::uint64_t plus_factor, limb plus, std::uint64_t minus_factor, limb minus, std::uint64_t& carry, std::uint64_t& borrow) // One limb of plus_factor * plus - minus_factor * minus, factors below 2^32
+		{
+			const std::uint64_t added = plus_factor * plus + carry, subtracted = minus_factor * minus + borrow;
+			carry = added >> 32;
+			borrow = (subtracted >> 32) + (limb(added) < limb(subtracted) ? 1 : 0);
+			return limb(limb(added) - limb(subtracted));
+		}
+
+		static int compare(const bigint& a, const bigint& b)
+		{
+			if (a._negative != b._negative)
+				return a._negative ? -1 : 1;
+			const int order = compare_limbs(a.data(), a._size, b.data(), b._size);
+			return a._negative ? -order : order;
+		}
+
+		static void divide(const bigint& a, const bigint& b, bigint* quotient, bigint* remainder) // Either result may be null or alias an operand
+		{
+			if (b._size == 0)
+				throw bigint_divide_by_zero();
+			if (compare_limbs(a.data(), a._size, b.data(), b._size) < 0)
+			{
+				if (remainder != nullptr)
+					*remainder = a;
+				if (quotient != nullptr)
+					*quotient = bigint();
+				return;
+			}
+			bigint q, r;
+			if (a._size <= 2) // Both below 2^64
+			{
+				const std::uint64_t dividend = a.low_bits(), divisor = b.low_bits();
+				q = bigint(dividend / divisor);
+				r = bigint(dividend % divisor);
+				q._negative = q._size > 0 && a._negative != b._negative;
+				r._negative = r._size > 0 && a._negative;
+				if (quotient != nullptr)
+					*quotient = std::move(q);
+				if (remainder != nullptr)
+					*remainder = std::move(r);
+				return;
+			}
+			q.reserve(a._size - b._size + 1);
+			r.reserve(b._size);
+			divide_limbs(a.data(), a._size, b.data(), b._size, q.data(), r.data());
+			q._size = a._size - b._size + 1;
+			q._negative = a._negative != b._negative;
+			q.trim();
+			r._size = b._size;
+			r._negative = a._negative;
+			r.trim();
+			if (quotient != nullptr)
+				*quotient = std::move(q);
+			if (remainder != nullptr)
+				*remainder = std::move(r);
+		}
+
+		static int leading_zeros(limb value) // value != 0
+		{
+			int count = 0;
+			for (; (value & 0x80000000u) == 0; value <<= 1)
+				++count;
+			return count;
+		}
+
+		static int compare_limbs(const limb* a, size_t a_size, const limb* b, size_t b_size)
+		{
+			if (a_size != b_size)
+				return a_size < b_size ? -1 : 1;
+			for (size_t index = a_size; index-- > 0;)
+				if (a[index] != b[index])
+					return a[index] < b[index] ? -1 : 1;
+			return 0;
+		}
+
+		static limb add_limbs(const limb* a, size_t a_size, const limb* b, size_t b_size, limb* result) // a_size >= b_size, a_size limbs of result, returns the carry; result may be a or b
+		{
+			std::uint64_t carry = 0;
+			size_t index = 0;
+			for (; index < b_size; ++index)
+			{
+				carry += std::uint64_t(a[index]) + b[index];
+				result[index] = limb(carry);
+				carry >>= 32;
+			}
+			for (; index < a_size; ++index)
+			{
+				carry += a[index];
+				result[index] = limb(carry);
+				carry >>= 32;
+			}
+			return limb(carry);
+		}
+
+		static void subtract_limbs(const limb* a, size_t a_size, const limb* b, size_t b_size, limb* result) // a >= b, a_size limbs of result; result may be a or b
+		{
+			std::uint64_t borrow = 0;
+			size_t index = 0;
+			for (; index < b_size; ++index)
+			{
+				const std::uint64_t difference = std::uint64_t(a[index]) - b[index] - borrow;
+				result[index] = limb(difference);
+				borrow = difference >> 63;
+			}
+			for (; index < a_size; ++index)
+			{
+				const std::uint64_t difference = std::uint64_t(a[index]) - borrow;
+				result[index] = limb(difference);
+				borrow = difference >> 63;
+			}
+		}
+
+		static limb divide_small(const limb* a, size_t a_size, limb divisor, limb* quotient) // Returns the remainder, quotient may be a
+		{
+			std::uint64_t remainder = 0;
+			for (size_t index = a_size; index-- > 0;)
+			{
+				const std::uint64_t current = remainder << 32 | a[index];
+				quotient[index] = limb(current / divisor);
+				remainder = current % divisor;
+			}
+			return limb(remainder);
+		}
+
+		static void multiply_schoolbook(const limb* a, size_t a_size, const limb* b, size_t b_size, limb* result) // a_size + b_size limbs of result, which must not overlap the factors
+		{
+			std::fill(result, result + a_size + b_size, limb(0));
+			for (size_t b_index = 0; b_index < b_size; ++b_index)
+			{
+				const std::uint64_t factor = b[b_index];
+				if (factor == 0)
+					continue;
+				std::uint64_t carry = 0;
+				for (size_t a_index = 0; a_index < a_size; ++a_index)
+				{
+					carry += factor * a[a_index] + result[a_index + b_index];
+					result[a_index + b_index] = limb(carry);
+					carry >>= 32;
+				}
+				result[a_size + b_index] = limb(carry);
+			}
+		}
+
+		static void multiply_padded(const limb* a, size_t a_size, const limb* b, size_t b_size, limb* result) // Like multiply_limbs, but the factors may have leading zero limbs
+		{
+			size_t a_used = a_size, b_used = b_size;
+			while (a_used > 0 && a[a_used - 1] == 0)
+				--a_used;
+			while (b_used > 0 && b[b_used - 1] == 0)
+				--b_used;
+			if (a_used == 0 || b_used == 0)
+				std::fill(result, result + a_size + b_size, limb(0));
+			else
+			{
+				multiply_limbs(a, a_used, b, b_used, result);
+				std::fill(result + a_used + b_used, result + a_size + b_size, limb(0));
+			}
+		}
+
+		static void multiply_limbs(const limb* a, size_t a_size, const limb* b, size_t b_size, limb* result) // Karatsuba above the threshold, a_size + b_size limbs of result, which must not overlap the factors
+		{
+			if (a_size < b_size)
+			{
+				std::swap(a, b);
+				std::swap(a_size, b_size);
+			}
+			if (b_size < karatsuba_threshold)
+			{
+				multiply_schoolbook(a, a_size, b, b_size, result);
+				return;
+			}
+			const size_t half = (a_size + 1) / 2;
+			if (b_size <= half) // Unbalanced, the longer factor is cut into pieces as long as the shorter one
+			{
+				std::fill(result, result + a_size + b_size, limb(0));
+				std::vector<limb> piece(2 * b_size);
+				for (size_t offset = 0; offset < a_size; offset += b_size)
+				{
+					const size_t length = std::min(b_size, a_size - offset);
+					multiply_padded(a + offset, length, b, b_size, piece.data());
+					add_limbs(result + offset, a_size + b_size - offset, piece.data(), length + b_size, result + offset);
+				}
+				return;
+			}
+			// a = a1 * B^half + a0 and b = b1 * B^half + b0, then a * b = z2 * B^(2 half) + (z1 - z2 - z0) * B^half + z0 with z1 = (a0 + a1)(b0 + b1)
+			const size_t high_a = a_size - half, high_b = b_size - half;
+			multiply_padded(a, half, b, half, result);
+			multiply_padded(a + half, high_a, b + half, high_b, result + 2 * half);
+			std::vector<limb> work(2 * (half + 1) + 2 * (half + 1));
+			limb* a_sum = work.data(), * b_sum = a_sum + half + 1, * middle = b_sum + half + 1;
+			a_sum[half] = add_limbs(a, half, a + half, high_a, a_sum);
+			b_sum[half] = add_limbs(b, half, b + half, high_b, b_sum);
+			multiply_padded(a_sum, half + 1, b_sum, half + 1, middle);
+			size_t middle_size = 2 * (half + 1);
+			subtract_limbs(middle, middle_size, result, 2 * half, middle);
+			subtract_limbs(middle, middle_size, result + 2 * half, high_a + high_b, middle);
+			while (middle_size > 0 && middle[middle_size - 1] == 0)
+				--middle_size;
+			add_limbs(result + half, a_size + b_size - half, middle, middle_size, result + half);
+		}
+
+		static void divide_limbs(const limb* u, size_t u_size, const limb* v, size_t v_size, limb* quotient, limb* remainder) // Knuth's algorithm D, u >= v, v[v_size - 1] != 0; u_size - v_size + 1 limbs of quotient and v_size of remainder, neither overlapping u
+		{
+			if (v_size == 1)
+			{
+				remainder[0] = divide_small(u, u_size, v[0], quotient);
+				return;
+			}
+			const int shift = leading_zeros(v[v_size - 1]);
+			limb small_work[2 * inline_limbs + 1]; // Operands below 2^128 divide without touching the heap
+			std::vector<limb> large_work;
+			limb* un = small_work;
+			if (u_size + 1 + v_size > 2 * inline_limbs + 1)
+			{
+				large_work.resize(u_size + 1 + v_size);
+				un = large_work.data();
+			}
+			limb* vn = un + u_size + 1;
+			for (size_t index = v_size - 1; index > 0; --index)
+				vn[index] = limb(v[index] << shift) | (shift == 0 ? 0 : limb(v[index - 1] >> (32 - shift)));
+			vn[0] = limb(v[0] << shift);
+			un[u_size] = shift == 0 ? 0 : limb(u[u_size - 1] >> (32 - shift));
+			for (size_t index = u_size - 1; index > 0; --index)
+				un[index] = limb(u[index] << shift) | (shift == 0 ? 0 : limb(u[index - 1] >> (32 - shift)));
+			un[0] = limb(u[0] << shift);
+			const std::uint64_t base = std::uint64_t(1) << 32;
+			for (size_t j = u_size - v_size + 1; j-- > 0;)
+			{
+				const std::uint64_t numerator = std::uint64_t(un[j + v_size]) << 32 | un[j + v_size - 1];
+				std::uint64_t q_hat = numerator / vn[v_size - 1], r_hat = numerator % vn[v_size - 1];
+				while (q_hat >= base || q_hat * vn[v_size - 2] > (r_hat << 32 | un[j + v_size - 2]))
+				{
+					--q_hat;
+					r_hat += vn[v_size - 1];
+					if (r_hat >= base)
+						break;
+				}
+				std::int64_t borrow = 0, t;
+				for (size_t index = 0; index < v_size; ++index)
+				{
+					const std::uint64_t product = q_hat * vn[index];
+					t = std::int64_t(un[index + j]) - borrow - std::int64_t(product & 0xFFFFFFFF);
+					un[index + j] = limb(t);
+					borrow = std::int64_t(product >> 32) - (t >> 32);
+				}
+				t = std::int64_t(un[j + v_size]) - borrow;
+				un[j + v_size] = limb(t);
+				if (t < 0) // q_hat was one too large, add v back
+				{
+					--q_hat;
+					std::uint64_t carry = 0;
+					for (size_t index = 0; index < v_size; ++index)
+					{
+						carry += std::uint64_t(un[index + j]) + vn[index];
+						un[index + j] = limb(carry);
+						carry >>= 32;
+					}
+					un[j + v_size] = limb(un[j + v_size] + carry);
+				}
+				quotient[j] = limb(q_hat);
+			}
+			for (size_t index = 0; index < v_size; ++index)
+				remainder[index] = limb(un[index] >> shift) | (shift == 0 ? 0 : limb(un[index + 1] << (32 - shift)));
+		}
+	};
+}
@@ -0,0 +1,544 @@
+#pragma once
+
+#include "matrix.hpp"
+#include <initializer_list>
+#include <type_traits>
+
+namespace zaoly
+{
+	template <typename number, size_t _row_count, size_t _column_count>
+	class fixed_matrix // Matrix with compile-time dimensions and inline storage, mismatched dimensions do not compile
+	{
+		static_assert(_row_count > 0 && _column_count > 0, "Matrix too small");
+
+		using row_type    = std::initializer_list<number>;
+		using matrix_type = std::initializer_list<row_type>;
+
+	public:
+		using value_type = number;
+
+		constexpr fixed_matrix() : _data{} {}
+
+		constexpr fixed_matrix(const matrix_type& nums) : _data{} // Missing elements are zero, extra elements are ignored
+		{
+			for (size_t row_index = 0; row_index < nums.size() && row_index < _row_count; ++row_index)
+				for (size_t column_index = 0; column_index < nums.begin()[row_index].size() && column_index < _column_count; ++column_index)
+					_data[row_index * _column_count + column_index] = nums.begin()[row_index].begin()[column_index];
+		}
+
+		explicit fixed_matrix(const matrix<number>& matr) : _data{}
+		{
+			if (matr.row_count() != _row_count || matr.column_count() != _column_count)
+				throw matrix_unaligned();
+			for (size_t index = 0; index < _row_count * _column_count; ++index)
+				_data[index] = matr.data()[index];
+		}
+
+		operator matrix<number>() const
+		{
+			matrix<number> result(_row_count, _column_count);
+			for (size_t index = 0; index < _row_count * _column_count; ++index)
+				result.data()[index] = _data[index];
+			return result;
+		}
+
+		static constexpr fixed_matrix identity()
+		{
+			static_assert(_row_count == _column_count, "Matrix unaligned");
+			fixed_matrix result;
+			for (size_t index = 0; index < _row_count; ++index)
+				result._data[index * _column_count + index] = 1;
+			return result;
+		}
+
+		static constexpr size_t row_count()
+		{
+			return _row_count;
+		}
+
+		static constexpr size_t column_count()
+		{
+			return _column_count;
+		}
+
+		constexpr number* data()
+		{
+			return _data;
+		}
+
+		constexpr const number* data() const
+		{
+			return _data;
+		}
+
+		constexpr number& data(size_t row_index, size_t column_index)
+		{
+			if (row_index >= _row_count || column_index >= _column_count)
+				throw subscript_out_of_range();
+			else
+				return _data[row_index * _column_count + column_index];
+		}
+
+		constexpr const number& data(size_t row_index, size_t column_index) const
+		{
+			if (row_index >= _row_count || column_index >= _column_count)
+				throw subscript_out_of_range();
+			else
+				return _data[row_index * _column_count + column_index];
+		}
+
+		constexpr fixed_matrix<number, _column_count, _row_count> transpose() const
+		{
+			fixed_matrix<number, _column_count, _row_count> result;
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+					result[column_index][row_index] = _data[row_index * _column_count + column_index];
+			return result;
+		}
+
+		constexpr number determinant() const
+		{
+			static_assert(_row_count == _column_count, "Matrix unaligned");
+			return fixed_determinant(std::integral_constant<size_t, _row_count>());
+		}
+
+		constexpr bool invertible() const
+		{
+			return determinant() != number{};
+		}
+
+		constexpr fixed_matrix inverse() const
+		{
+			static_assert(_row_count == _column_count, "Matrix unaligned");
+			return fixed_inverse(std::integral_constant<size_t, _row_count>());
+		}
+
+		void print(std::ostream& os = std::cout, const char* delimeter1 = " ", const char* delimeter2 = "\n") const
+		{
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+			{
+				if (row_index > 0)
+					os << delimeter2;
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+				{
+					if (column_index > 0)
+						os << delimeter1;
+					os << _data[row_index * _column_count + column_index];
+				}
+			}
+		}
+
+		constexpr fixed_matrix& operator+=(const fixed_matrix& matr)
+		{
+			for (size_t index = 0; index < _row_count * _column_count; ++index)
+				_data[index] += matr._data[index];
+			return *this;
+		}
+
+		constexpr fixed_matrix& operator-=(const fixed_matrix& matr)
+		{
+			for (size_t index = 0; index < _row_count * _column_count; ++index)
+				_data[index] -= matr._data[index];
+			return *this;
+		}
+
+		constexpr fixed_matrix& operator*=(const fixed_matrix<number, _column_count, _column_count>& matr)
+		{
+			return *this = *this * matr;
+		}
+
+		constexpr fixed_matrix& operator*=(const number& scalar)
+		{
+			for (size_t index = 0; index < _row_count * _column_count; ++index)
+				_data[index] *= scalar;
+			return *this;
+		}
+
+		constexpr fixed_matrix& operator/=(const number& scalar)
+		{
+			for (size_t index = 0; index < _row_count * _column_count; ++index)
+				_data[index] /= scalar;
+			return *this;
+		}
+
+		constexpr number* operator[](size_t row_index)
+		{
+			return _data + row_index * _column_count;
+		}
+
+		constexpr const number* operator[](size_t row_index) const
+		{
+			return _data + row_index * _column_count;
+		}
+
+		constexpr number& operator()(size_t row_index, size_t column_index)
+		{
+			return data(row_index, column_index);
+		}
+
+		constexpr const number& operator()(size_t row_index, size_t column_index) const
+		{
+			return data(row_index, column_index);
+		}
+
+	private:
+		number _data[_row_count * _column_count];
+
+		constexpr const number& at(size_t row_index, size_t column_index) const
+		{
+			return _data[row_index * _column_count + column_index];
+		}
+
+		constexpr number fixed_determinant(std::integral_constant<size_t, 1>) const
+		{
+			return _data[0];
+		}
+
+		constexpr number fixed_determinant(std::integral_constant<size_t, 2>) const
+		{
+			return _data[0] * _data[3] - _data[1] * _data[2];
+		}
+
+		constexpr number fixed_determinant(std::integral_constant<size_t, 3>) const
+		{
+			return
+				at(0, 0) * (at(1, 1) * at(2, 2) - at(1, 2) * at(2, 1)) -
+				at(0, 1) * (at(1, 0) * at(2, 2) - at(1, 2) * at(2, 0)) +
+				at(0, 2) * (at(1, 0) * at(2, 1) - at(1, 1) * at(2, 0));
+		}
+
+		constexpr number fixed_determinant(std::integral_constant<size_t, 4>) const // Expansion by complementary 2x2 minors of the top and bottom rows
+		{
+			const number s0 = at(0, 0) * at(1, 1) - at(1, 0) * at(0, 1);
+			const number s1 = at(0, 0) * at(1, 2) - at(1, 0) * at(0, 2);
+			const number s2 = at(0, 0) * at(1, 3) - at(1, 0) * at(0, 3);
+			const number s3 = at(0, 1) * at(1, 2) - at(1, 1) * at(0, 2);
+			const number s4 = at(0, 1) * at(1, 3) - at(1, 1) * at(0, 3);
+			const number s5 = at(0, 2) * at(1, 3) - at(1, 2) * at(0, 3);
+			const number c5 = at(2, 2) * at(3, 3) - at(3, 2) * at(2, 3);
+			const number c4 = at(2, 1) * at(3, 3) - at(3, 1) * at(2, 3);
+			const number c3 = at(2, 1) * at(3, 2) - at(3, 1) * at(2, 2);
+			const number c2 = at(2, 0) * at(3, 3) - at(3, 0) * at(2, 3);
+			const number c1 = at(2, 0) * at(3, 2) - at(3, 0) * at(2, 2);
+			const number c0 = at(2, 0) * at(3, 1) - at(3, 0) * at(2, 1);
+			return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+		}
+
+		constexpr bool select_pivot(size_t step, fixed_matrix* companion, bool& negative) // Brings the pivot chosen as by lu_decomposition to the diagonal, swapping the same rows of companion
+		{
+			size_t pivot_row = step;
+			for (size_t row_index = step + 1; row_index < _row_count; ++row_index)
+				if (better_pivot(at(row_index, step), at(pivot_row, step), std::is_floating_point<number>()))
+					pivot_row = row_index;
+			if (at(pivot_row, step) == number{})
+				return false;
+			if (pivot_row != step)
+			{
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+				{
+					const number swapped = _data[step * _column_count + column_index];
+					_data[step * _column_count + column_index] = _data[pivot_row * _column_count + column_index];
+					_data[pivot_row * _column_count + column_index] = swapped;
+					if (companion)
+					{
+						const number swapped_companion = companion->_data[step * _column_count + column_index];
+						companion->_data[step * _column_count + column_index] = companion->_data[pivot_row * _column_count + column_index];
+						companion->_data[pivot_row * _column_count + column_index] = swapped_companion;
+					}
+				}
+				negative = !negative;
+			}
+			return true;
+		}
+
+		// Floating-point types pivot on the largest magnitude for stability, exact types only need a non-zero pivot
+		static constexpr bool better_pivot(const number& candidate, const number& current, std::true_type)
+		{
+			return (candidate < number{} ? -candidate : candidate) > (current < number{} ? -current : current);
+		}
+
+		static constexpr bool better_pivot(const number& candidate, const number& current, std::false_type)
+		{
+			return current == number{} && candidate != number{};
+		}
+
+		template <size_t size>
+		constexpr number fixed_determinant(std::integral_constant<size_t, size>) const
+		{
+			return elimination_determinant(exact_elimination<number>());
+		}
+
+		constexpr number elimination_determinant(std::true_type) const // Bareiss elimination on a copy, every division is exact
+		{
+			constexpr size_t size = _row_count;
+			fixed_matrix work = *this;
+			number previous = 1;
+			bool negative = false;
+			for (size_t step = 0; step + 1 < size; ++step)
+			{
+				if (!work.select_pivot(step, nullptr, negative))
+					return number{};
+				const number pivot = work.at(step, step);
+				for (size_t row_index = step + 1; row_index < size; ++row_index)
+				{
+					const number factor = work.at(row_index, step);
+					for (size_t column_index = step + 1; column_index < size; ++column_index)
+						work[row_index][column_index] = (pivot * work.at(row_index, column_index) - factor * work.at(step, column_index)) / previous;
+				}
+				previous = pivot;
+			}
+			return negative ? -work.at(size - 1, size - 1) : work.at(size - 1, size - 1);
+		}
+
+		constexpr number elimination_determinant(std::false_type) const // Gaussian elimination on a copy
+		{
+			constexpr size_t size = _row_count;
+			fixed_matrix work = *this;
+			number result = 1;
+			bool negative = false;
+			for (size_t step = 0; step < size; ++step)
+			{
+				if (!work.select_pivot(step, nullptr, negative))
+					return number{};
+				result *= work.at(step, step);
+				for (size_t row_index = step + 1; row_index < size; ++row_index)
+				{
+					const number factor = work.at(row_index, step) / work.at(step, step);
+					for (size_t column_index = step; column_index < size; ++column_index)
+						work[row_index][column_index] -= factor * work.at(step, column_index);
+				}
+			}
+			return negative ? -result : result;
+		}
+
+		constexpr fixed_matrix fixed_inverse(std::integral_constant<size_t, 1>) const
+		{
+			if (_data[0] == number{})
+				throw matrix_singular();
+			fixed_matrix result;
+			result._data[0] = number(1) / _data[0];
+			return result;
+		}
+
+		constexpr fixed_matrix fixed_inverse(std::integral_constant<size_t, 2>) const
+		{
+			const number det = fixed_determinant(std::integral_constant<size_t, 2>());
+			if (det == number{})
+				throw matrix_singular();
+			fixed_matrix result;
+			result._data[0] = _data[3] / det;
+			result._data[1] = -_data[1] / det;
+			result._data[2] = -_data[2] / det;
+			result._data[3] = _data[0] / det;
+			return result;
+		}
+
+		constexpr fixed_matrix fixed_inverse(std::integral_constant<size_t, 3>) const // Adjugate over determinant
+		{
+			const number c00 = at(1, 1) * at(2, 2) - at(1, 2) * at(2, 1);
+			const number c01 = at(1, 2) * at(2, 0) - at(1, 0) * at(2, 2);
+			const number c02 = at(1, 0) * at(2, 1) - at(1, 1) * at(2, 0);
+			const number det = at(0, 0) * c00 + at(0, 1) * c01 + at(0, 2) * c02;
+			if (det == number{})
+				throw matrix_singular();
+			fixed_matrix result;
+			result._data[0] = c00 / det;
+			result._data[1] = (at(0, 2) * at(2, 1) - at(0, 1) * at(2, 2)) / det;
+			result._data[2] = (at(0, 1) * at(1, 2) - at(0, 2) * at(1, 1)) / det;
+			result._data[3] = c01 / det;
+			result._data[4] = (at(0, 0) * at(2, 2) - at(0, 2) * at(2, 0)) / det;
+			result._data[5] = (at(0, 2) * at(1, 0) - at(0, 0) * at(1, 2)) / det;
+			result._data[6] = c02 / det;
+			result._data[7] = (at(0, 1) * at(2, 0) - at(0, 0) * at(2, 1)) / det;
+			result._data[8] = (at(0, 0) * at(1, 1) - at(0, 1) * at(1, 0)) / det;
+			return result;
+		}
+
+		constexpr fixed_matrix fixed_inverse(std::integral_constant<size_t, 4>) const // Adjugate built from the same 2x2 minors as the determinant
+		{
+			const number s0 = at(0, 0) * at(1, 1) - at(1, 0) * at(0, 1);
+			const number s1 = at(0, 0) * at(1, 2) - at(1, 0) * at(0, 2);
+			const number s2 = at(0, 0) * at(1, 3) - at(1, 0) * at(0, 3);
+			const number s3 = at(0, 1) * at(1, 2) - at(1, 1) * at(0, 2);
+			const number s4 = at(0, 1) * at(1, 3) - at(1, 1) * at(0, 3);
+			const number s5 = at(0, 2) * at(1, 3) - at(1, 2) * at(0, 3);
+			const number c5 = at(2, 2) * at(3, 3) - at(3, 2) * at(2, 3);
+			const number c4 = at(2, 1) * at(3, 3) - at(3, 1) * at(2, 3);
+			const number c3 = at(2, 1) * at(3, 2) - at(3, 1) * at(2, 2);
+			const number c2 = at(2, 0) * at(3, 3) - at(3, 0) * at(2, 3);
+			const number c1 = at(2, 0) * at(3, 2) - at(3, 0) * at(2, 2);
+			const number c0 = at(2, 0) * at(3, 1) - at(3, 0) * at(2, 1);
+			const number det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+			if (det == number{})
+				throw matrix_singular();
+			fixed_matrix result;
+			result._data[0] = (at(1, 1) * c5 - at(1, 2) * c4 + at(1, 3) * c3) / det;
+			result._data[1] = (-at(0, 1) * c5 + at(0, 2) * c4 - at(0, 3) * c3) / det;
+			result._data[2] = (at(3, 1) * s5 - at(3, 2) * s4 + at(3, 3) * s3) / det;
+			result._data[3] = (-at(2, 1) * s5 + at(2, 2) * s4 - at(2, 3) * s3) / det;
+			result._data[4] = (-at(1, 0) * c5 + at(1, 2) * c2 - at(1, 3) * c1) / det;
+			result._data[5] = (at(0, 0) * c5 - at(0, 2) * c2 + at(0, 3) * c1) / det;
+			result._data[6] = (-at(3, 0) * s5 + at(3, 2) * s2 - at(3, 3) * s1) / det;
+			result._data[7] = (at(2, 0) * s5 - at(2, 2) * s2 + at(2, 3) * s1) / det;
+			result._data[8] = (at(1, 0) * c4 - at(1, 1) * c2 + at(1, 3) * c0) / det;
+			result._data[9] = (-at(0, 0) * c4 + at(0, 1) * c2 - at(0, 3) * c0) / det;
+			result._data[10] = (at(3, 0) * s4 - at(3, 1) * s2 + at(3, 3) * s0) / det;
+			result._data[11] = (-at(2, 0) * s4 + at(2, 1) * s2 - at(2, 3) * s0) / det;
+			result._data[12] = (-at(1, 0) * c3 + at(1, 1) * c1 - at(1, 2) * c0) / det;
+			result._data[13] = (at(0, 0) * c3 - at(0, 1) * c1 + at(0, 2) * c0) / det;
+			result._data[14] = (-at(3, 0) * s3 + at(3, 1) * s1 - at(3, 2) * s0) / det;
+			result._data[15] = (at(2, 0) * s3 - at(2, 1) * s1 + at(2, 2) * s0) / det;
+			return result;
+		}
+
+		template <size_t size>
+		constexpr fixed_matrix fixed_inverse(std::integral_constant<size_t, size>) const
+		{
+			return elimination_inverse(exact_elimination<number>());
+		}
+
+		constexpr fixed_matrix elimination_inverse(std::true_type) const // Fraction-free Gauss-Jordan on [A | I], leaving [dI | d * A^-1]
+		{
+			constexpr size_t size = _row_count;
+			fixed_matrix work = *this, result = identity();
+			number previous = 1;
+			bool negative = false;
+			for (size_t step = 0; step < size; ++step)
+			{
+				if (!work.select_pivot(step, &result, negative))
+					throw matrix_singular();
+				const number pivot = work.at(step, step);
+				for (size_t row_index = 0; row_index < size; ++row_index)
+				{
+					if (row_index == step)
+						continue;
+					const number factor = work.at(row_index, step);
+					for (size_t column_index = 0; column_index < size; ++column_index)
+					{
+						if (column_index != step)
+							work[row_index][column_index] = (pivot * work.at(row_index, column_index) - factor * work.at(step, column_index)) / previous;
+						result[row_index][column_index] = (pivot * result.at(row_index, column_index) - factor * result.at(step, column_index)) / previous;
+					}
+					work[row_index][step] = number{};
+				}
+				previous = pivot;
+			}
+			for (size_t index = 0; index < size * size; ++index)
+				result._data[index] /= previous;
+			return result;
+		}
+
+		constexpr fixed_matrix elimination_inverse(std::false_type) const // Gauss-Jordan elimination
+		{
+			constexpr size_t size = _row_count;
+			fixed_matrix work = *this, result = identity();
+			bool negative = false;
+			for (size_t step = 0; step < size; ++step)
+			{
+				if (!work.select_pivot(step, &result, negative))
+					throw matrix_singular();
+				const number diagonal = work.at(step, step);
+				for (size_t column_index = 0; column_index < size; ++column_index)
+				{
+					work[step][column_index] /= diagonal;
+					result[step][column_index] /= diagonal;
+				}
+				for (size_t row_index = 0; row_index < size; ++row_index)
+				{
+					if (row_index == step)
+						continue;
+					const number factor = work.at(row_index, step);
+					for (size_t column_index = 0; column_index < size; ++column_index)
+					{
+						work[row_index][column_index] -= factor * work.at(step, column_index);
+						result[row_index][column_index] -= factor * result.at(step, column_index);
+					}
+				}
+			}
+			return result;
+		}
+	};
+
+	template <typename number, size_t _row_count, size_t _column_count>
+	constexpr fixed_matrix<number, _row_count, _column_count> operator+(const fixed_matrix<number, _row_count, _column_count>& a, const fixed_matrix<number, _row_count, _column_count>& b)
+	{
+		fixed_matrix<number, _row_count, _column_count> result = a;
+		return result += b;
+	}
+
+	template <typename number, size_t _row_count, size_t _column_count>
+	constexpr fixed_matrix<number, _row_count, _column_count> operator-(const fixed_matrix<number, _row_count, _column_count>& a, const fixed_matrix<number, _row_count, _column_count>& b)
+	{
+		fixed_matrix<number, _row_count, _column_count> result = a;
+		return result -= b;
+	}
+
+	template <typename number, size_t _row_count, size_t _column_count>
+	constexpr fixed_matrix<number, _row_count, _column_count> operator-(const fixed_matrix<number, _row_count, _column_count>& a)
+	{
+		fixed_matrix<number, _row_count, _column_count> result;
+		for (size_t index = 0; index < _row_count * _column_count; ++index)
+			result.data()[index] = -a.data()[index];
+		return result;
+	}
+
+	template <typename number, size_t _row_count, size_t _mid_count, size_t _column_count>
+	constexpr fixed_matrix<number, _row_count, _column_count> operator*(const fixed_matrix<number, _row_count, _mid_count>& a, const fixed_matrix<number, _mid_count, _column_count>& b)
+	{
+		fixed_matrix<number, _row_count, _column_count> result;
+		for (size_t row_index = 0; row_index < _row_count; ++row_index)
+			for (size_t mid_index = 0; mid_index < _mid_count; ++mid_index)
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+					result[row_index][column_index] += a[row_index][mid_index] * b[mid_index][column_index];
+		return result;
+	}
+
+	template <typename number, size_t _row_count, size_t _column_count>
+	constexpr fixed_matrix<number, _row_count, _column_count> operator*(const fixed_matrix<number, _row_count, _column_count>& a, const typename fixed_matrix<number, _row_count, _column_count>::value_type& b)
+	{
+		fixed_matrix<number, _row_count, _column_count> result = a;
+		return result *= b;
+	}
+
+	template <typename number, size_t _row_count, size_t _column_count>
+	constexpr fixed_matrix<number, _row_count, _column_count> operator*(const typename fixed_matrix<number, _row_count, _column_count>::value_type& a, const fixed_matrix<number, _row_count, _column_count>& b)
+	{
+		fixed_matrix<number, _row_count, _column_count> result = b;
+		return result *= a;
+	}
+
+	template <typename number, size_t _row_count, size_t _column_count>
+	constexpr fixed_matrix<number, _row_count, _column_count> operator/(const fixed_matrix<number, _row_count, _column_count>& a, const typename fixed_matrix<number, _row_count, _column_count>::value_type& b)
+	{
+		fixed_matrix<number, _row_count, _column_count> result = a;
+		return result /= b;
+	}
+
+	template <typename number, size_t _row_count, size_t _column_count>
+	constexpr fixed_matrix<number, _row_count, _column_count> operator/(const fixed_matrix<number, _row_count, _column_count>& a, const fixed_matrix<number, _column_count, _column_count>& b)
+	{
+		return a * b.inverse();
+	}
+
+	template <typename number, size_t _row_count, size_t _column_count>
+	constexpr bool operator==(const fixed_matrix<number, _row_count, _column_count>& a, const fixed_matrix<number, _row_count, _column_count>& b)
+	{
+		for (size_t index = 0; index < _row_count * _column_count; ++index)
+			if (a.data()[index] != b.data()[index])
+				return false;
+		return true;
+	}
+
+	template <typename number, size_t _row_count, size_t _column_count>
+	constexpr bool operator!=(const fixed_matrix<number, _row_count, _column_count>& a, const fixed_matrix<number, _row_count, _column_count>& b)
+	{
+		return !(a == b);
+	}
+
+	template <typename number, size_t _row_count, size_t _column_count>
+	std::ostream& operator<<(std::ostream& os, const fixed_matrix<number, _row_count, _column_count>& matr)
+	{
+		matr.print(os);
+		return os;
+	}
+}
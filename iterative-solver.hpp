@@ -0,0 +1,356 @@
+#pragma once
+
+#include "sparse-matrix.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace zaoly
+{
+	// The solvers accept any operator A for which multiply_into(y, A, x) computes y = A * x, such as matrix and sparse_matrix.
+	// A preconditioner M is any type with apply(r, z) computing z = M^-1 * r.
+
+	struct iterative_options
+	{
+		size_t max_iterations = 1000;
+		double tolerance = 1e-10; // On the residual norm relative to the norm of b
+		size_t restart = 30; // Krylov basis size of GMRES
+	};
+
+	struct iterative_result
+	{
+		size_t iterations = 0;
+		double residual = 0; // Final relative residual norm
+		bool converged = false;
+	};
+
+	struct identity_preconditioner
+	{
+		template <typename number>
+		void apply(const std::vector<number>& r, std::vector<number>& z) const
+		{
+			z = r;
+		}
+	};
+
+	template <typename number>
+	class jacobi_preconditioner // M = diag(A), cheap and effective for diagonally dominant systems
+	{
+	public:
+		template <typename allocator_type>
+		explicit jacobi_preconditioner(const matrix<number, allocator_type>& a) : _inverse_diagonal(std::min(a.row_count(), a.column_count()))
+		{
+			for (size_t index = 0; index < _inverse_diagonal.size(); ++index)
+				_inverse_diagonal[index] = invert(a.data(index, index));
+		}
+
+		explicit jacobi_preconditioner(const sparse_matrix<number>& a) : _inverse_diagonal(std::min(a.row_count(), a.column_count()))
+		{
+			for (size_t index = 0; index < _inverse_diagonal.size(); ++index)
+				_inverse_diagonal[index] = invert(a.data(index, index));
+		}
+
+		void apply(const std::vector<number>& r, std::vector<number>& z) const
+		{
+			z.resize(r.size());
+			for (size_t index = 0; index < r.size(); ++index)
+				z[index] = r[index] * _inverse_diagonal[index];
+		}
+
+	private:
+		std::vector<number> _inverse_diagonal;
+
+		static number invert(const number& diagonal)
+		{
+			if (diagonal == number{})
+				throw matrix_singular();
+			return number(1) / diagonal;
+		}
+	};
+
+	template <typename number>
+	class incomplete_lu_preconditioner // ILU(0): LU restricted to the sparsity pattern of A, L has a unit diagonal and shares storage with U
+	{
+	public:
+		explicit incomplete_lu_preconditioner(const sparse_matrix<number>& a) :
+			_row_offsets(a.row_offsets()), _column_indices(a.column_indices()), _values(a.values()), _diagonal(a.row_count())
+		{
+			if (a.row_count() != a.column_count())
+				throw matrix_unaligned();
+			const size_t n = a.row_count();
+			std::vector<size_t> position(n, size_t(-1)); // Index into _values of each column of the current row
+			for (size_t row_index = 0; row_index < n; ++row_index)
+			{
+				const size_t row_begin = _row_offsets[row_index], row_end = _row_offsets[row_index + 1];
+				for (size_t index = row_begin; index < row_end; ++index)
+					position[_column_indices[index]] = index;
+				for (size_t index = row_begin; index < row_end && _column_indices[index] < row_index; ++index)
+				{
+					const size_t mid_index = _column_indices[index];
+					_values[index] /= _values[_diagonal[mid_index]];
+					for (size_t other = _diagonal[mid_index] + 1; other < _row_offsets[mid_index + 1]; ++other)
+						if (position[_column_indices[other]] != size_t(-1))
+							_values[position[_column_indices[other]]] -= _values[index] * _values[other];
+				}
+				if (position[row_index] == size_t(-1) || _values[position[row_index]] == number{})
+					throw matrix_singular();
+				_diagonal[row_index] = position[row_index];
+				for (size_t index = row_begin; index < row_end; ++index)
+					position[_column_indices[index]] = size_t(-1);
+			}
+		}
+
+		void apply(const std::vector<number>& r, std::vector<number>& z) const // Forward with L, then backward with U
+		{
+			const size_t n = _diagonal.size();
+			z = r;
+			for (size_t row_index = 0; row_index < n; ++row_index)
+				for (size_t index = _row_offsets[row_index]; index < _diagonal[row_index]; ++index)
+					z[row_index] -= _values[index] * z[_column_indices[index]];
+			for (size_t row_index = n; row_index-- > 0;)
+			{
+				for (size_t index = _diagonal[row_index] + 1; index < _row_offsets[row_index + 1]; ++index)
+					z[row_index] -= _values[index] * z[_column_indices[index]];
+				z[row_index] /= _values[_diagonal[row_index]];
+			}
+		}
+
+	private:
+		std::vector<size_t> _row_offsets;
+		std::vector<size_t> _column_indices;
+		std::vector<number> _values;
+		std::vector<size_t> _diagonal; // Index into _values of each diagonal element
+	};
+
+	template <typename number>
+	struct krylov_operations // Dense vector kernels shared by the solvers
+	{
+		static number dot(const std::vector<number>& x, const std::vector<number>& y)
+		{
+			number result{};
+			for (size_t index = 0; index < x.size(); ++index)
+				result += x[index] * y[index];
+			return result;
+		}
+
+		static double norm(const std::vector<number>& x)
+		{
+			return std::sqrt(double(dot(x, x)));
+		}
+
+		static void axpy(const number& alpha, const std::vector<number>& x, std::vector<number>& y) // y += alpha * x
+		{
+			for (size_t index = 0; index < x.size(); ++index)
+				y[index] += alpha * x[index];
+		}
+
+		template <typename operator_type>
+		static void residual(const operator_type& a, const std::vector<number>& b, const std::vector<number>& x, std::vector<number>& r) // r = b - A * x
+		{
+			multiply_into(r, a, x);
+			for (size_t index = 0; index < r.size(); ++index)
+				r[index] = b[index] - r[index];
+		}
+
+		template <typename operator_type>
+		static void prepare(const operator_type& a, const std::vector<number>& b, std::vector<number>& x) // An empty x starts from zero
+		{
+			if (a.row_count() != a.column_count() || a.row_count() != b.size())
+				throw matrix_unaligned();
+			if (x.empty())
+				x.assign(b.size(), number{});
+			else if (x.size() != b.size())
+				throw matrix_unaligned();
+		}
+	};
+
+	// Preconditioned conjugate gradient, A must be symmetric positive definite and so must the preconditioner
+	template <typename operator_type, typename number, typename preconditioner_type = identity_preconditioner>
+	iterative_result conjugate_gradient(const operator_type& a, const std::vector<number>& b, std::vector<number>& x,
+		const preconditioner_type& preconditioner = preconditioner_type(), const iterative_options& options = iterative_options())
+	{
+		using operations = krylov_operations<number>;
+		operations::prepare(a, b, x);
+		iterative_result result;
+		const double b_norm = operations::norm(b);
+		if (b_norm == 0)
+		{
+			std::fill(x.begin(), x.end(), number{});
+			result.converged = true;
+			return result;
+		}
+		std::vector<number> r, z, p, q;
+		operations::residual(a, b, x, r);
+		result.residual = operations::norm(r) / b_norm;
+		if (result.residual <= options.tolerance)
+		{
+			result.converged = true;
+			return result;
+		}
+		preconditioner.apply(r, z);
+		p = z;
+		number rho = operations::dot(r, z);
+		while (result.iterations < options.max_iterations)
+		{
+			++result.iterations;
+			multiply_into(q, a, p);
+			const number alpha = rho / operations::dot(p, q);
+			operations::axpy(alpha, p, x);
+			operations::axpy(-alpha, q, r);
+			result.residual = operations::norm(r) / b_norm;
+			if (result.residual <= options.tolerance)
+			{
+				result.converged = true;
+				break;
+			}
+			preconditioner.apply(r, z);
+			const number next_rho = operations::dot(r, z);
+			const number beta = next_rho / rho;
+			rho = next_rho;
+			for (size_t index = 0; index < p.size(); ++index)
+				p[index] = z[index] + beta * p[index];
+		}
+		return result;
+	}
+
+	// Right-preconditioned BiCGSTAB for general non-symmetric A, stops early when the method breaks down
+	template <typename operator_type, typename number, typename preconditioner_type = identity_preconditioner>
+	iterative_result bicgstab(const operator_type& a, const std::vector<number>& b, std::vector<number>& x,
+		const preconditioner_type& preconditioner = preconditioner_type(), const iterative_options& options = iterative_options())
+	{
+		using operations = krylov_operations<number>;
+		operations::prepare(a, b, x);
+		iterative_result result;
+		const double b_norm = operations::norm(b);
+		if (b_norm == 0)
+		{
+			std::fill(x.begin(), x.end(), number{});
+			result.converged = true;
+			return result;
+		}
+		std::vector<number> r, shadow, p(b.size()), v(b.size()), p_hat, s(b.size()), s_hat, t;
+		operations::residual(a, b, x, r);
+		shadow = r;
+		result.residual = operations::norm(r) / b_norm;
+		number rho = 1, alpha = 1, omega = 1;
+		while (result.residual > options.tolerance && result.iterations < options.max_iterations)
+		{
+			++result.iterations;
+			const number next_rho = operations::dot(shadow, r);
+			if (next_rho == number{})
+				break;
+			const number beta = next_rho / rho * (alpha / omega);
+			rho = next_rho;
+			for (size_t index = 0; index < p.size(); ++index)
+				p[index] = r[index] + beta * (p[index] - omega * v[index]);
+			preconditioner.apply(p, p_hat);
+			multiply_into(v, a, p_hat);
+			const number shadow_v = operations::dot(shadow, v);
+			if (shadow_v == number{})
+				break;
+			alpha = rho / shadow_v;
+			for (size_t index = 0; index < s.size(); ++index)
+				s[index] = r[index] - alpha * v[index];
+			operations::axpy(alpha, p_hat, x);
+			result.residual = operations::norm(s) / b_norm;
+			if (result.residual <= options.tolerance)
+				break;
+			preconditioner.apply(s, s_hat);
+			multiply_into(t, a, s_hat);
+			const number t_t = operations::dot(t, t);
+			if (t_t == number{})
+				break;
+			omega = operations::dot(t, s) / t_t;
+			operations::axpy(omega, s_hat, x);
+			for (size_t index = 0; index < r.size(); ++index)
+				r[index] = s[index] - omega * t[index];
+			result.residual = operations::norm(r) / b_norm;
+			if (omega == number{})
+				break;
+		}
+		result.converged = result.residual <= options.tolerance;
+		return result;
+	}
+
+	// Restarted GMRES(options.restart) with right preconditioning, the residual is minimized over each Krylov basis by Givens rotations
+	template <typename operator_type, typename number, typename preconditioner_type = identity_preconditioner>
+	iterative_result gmres(const operator_type& a, const std::vector<number>& b, std::vector<number>& x,
+		const preconditioner_type& preconditioner = preconditioner_type(), const iterative_options& options = iterative_options())
+	{
+		using operations = krylov_operations<number>;
+		operations::prepare(a, b, x);
+		iterative_result result;
+		const double b_norm = operations::norm(b);
+		if (b_norm == 0)
+		{
+			std::fill(x.begin(), x.end(), number{});
+			result.converged = true;
+			return result;
+		}
+		const size_t restart = std::max<size_t>(options.restart, 1);
+		std::vector<std::vector<number>> basis(restart + 1);
+		std::vector<number> hessenberg((restart + 1) * restart), cosines(restart), sines(restart), g(restart + 1), y(restart), w, z;
+		std::vector<number>& r = basis[0];
+		operations::residual(a, b, x, r);
+		number beta = number(operations::norm(r));
+		result.residual = double(beta) / b_norm;
+		while (result.residual > options.tolerance && result.iterations < options.max_iterations)
+		{
+			for (size_t index = 0; index < r.size(); ++index)
+				r[index] /= beta;
+			std::fill(g.begin(), g.end(), number{});
+			g[0] = beta;
+			size_t size = 0;
+			while (size < restart && result.iterations < options.max_iterations)
+			{
+				const size_t step = size++;
+				++result.iterations;
+				preconditioner.apply(basis[step], z);
+				multiply_into(w, a, z);
+				for (size_t index = 0; index <= step; ++index) // Modified Gram-Schmidt
+				{
+					const number h = operations::dot(w, basis[index]);
+					hessenberg[index * restart + step] = h;
+					operations::axpy(-h, basis[index], w);
+				}
+				const number h_next = number(operations::norm(w));
+				for (size_t index = 0; index < step; ++index)
+				{
+					const number upper = hessenberg[index * restart + step], lower = hessenberg[(index + 1) * restart + step];
+					hessenberg[index * restart + step] = cosines[index] * upper + sines[index] * lower;
+					hessenberg[(index + 1) * restart + step] = -sines[index] * upper + cosines[index] * lower;
+				}
+				const number diagonal = hessenberg[step * restart + step];
+				const number radius = number(std::sqrt(double(diagonal * diagonal + h_next * h_next)));
+				cosines[step] = radius == number{} ? number(1) : diagonal / radius;
+				sines[step] = radius == number{} ? number{} : h_next / radius;
+				hessenberg[step * restart + step] = radius;
+				g[step + 1] = -sines[step] * g[step];
+				g[step] = cosines[step] * g[step];
+				result.residual = std::abs(double(g[step + 1])) / b_norm;
+				if (result.residual <= options.tolerance || h_next == number{})
+					break;
+				basis[step + 1] = w;
+				for (size_t index = 0; index < w.size(); ++index)
+					basis[step + 1][index] /= h_next;
+			}
+			for (size_t row_index = size; row_index-- > 0;) // Back substitution on the triangular Hessenberg factor
+			{
+				number sum = g[row_index];
+				for (size_t column_index = row_index + 1; column_index < size; ++column_index)
+					sum -= hessenberg[row_index * restart + column_index] * y[column_index];
+				y[row_index] = sum / hessenberg[row_index * restart + row_index];
+			}
+			w.assign(x.size(), number{});
+			for (size_t index = 0; index < size; ++index)
+				operations::axpy(y[index], basis[index], w);
+			preconditioner.apply(w, z);
+			operations::axpy(number(1), z, x);
+			operations::residual(a, b, x, r);
+			beta = number(operations::norm(r));
+			result.residual = double(beta) / b_norm;
+		}
+		result.converged = result.residual <= options.tolerance;
+		return result;
+	}
+}
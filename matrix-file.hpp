@@ -0,0 +1,379 @@
+#pragma once
+
+#include "matrix.hpp"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace zaoly
+{
+	// Binary matrix file: a 64-byte header, then the elements row-major with no padding, starting at a multiple of the alignment.
+	//  0  char[8]  magic "ZAOLYMTX"
+	//  8  uint32   0x01020304 in the byte order of the writer
+	// 12  uint16   format version
+	// 14  uint16   element kind: 1 floating point, 2 signed integer, 3 unsigned integer
+	// 16  uint32   element size in bytes
+	// 20  uint32   alignment of the element data in the file
+	// 24  uint64   row count
+	// 32  uint64   column count
+	// 40  reserved, zero
+
+	class matrix_file_error : public std::runtime_error
+	{
+	public:
+		matrix_file_error(const char* message) : std::runtime_error(message) {}
+	};
+
+	template <typename number>
+	struct matrix_file_element // Element types that can be stored, the kind and size in the header must match on load
+	{
+		static_assert(std::is_arithmetic<number>::value, "Only arithmetic elements have a binary matrix file format");
+		static constexpr std::uint16_t kind = std::is_floating_point<number>::value ? 1 : std::is_signed<number>::value ? 2 : 3;
+	};
+
+	struct matrix_file_header
+	{
+		static constexpr size_t size = 64, alignment = 64;
+		static constexpr size_t first_chunk = size_t(1) << 24; // Bytes load_matrix allocates first when the stream cannot tell its length
+		static constexpr std::uint32_t byte_order = 0x01020304;
+		static constexpr std::uint16_t version = 1;
+
+		std::uint16_t element_kind{};
+		std::uint32_t element_size{}, data_alignment = alignment;
+		std::uint64_t row_count{}, column_count{};
+		bool swapped = false; // Written with the other byte order
+
+		size_t data_offset() const
+		{
+			return (size + data_alignment - 1) / data_alignment * data_alignment;
+		}
+
+		void write(char* buffer) const
+		{
+			std::memset(buffer, 0, size);
+			std::memcpy(buffer, "ZAOLYMTX", 8);
+			std::memcpy(buffer + 8, &byte_order, 4);
+			std::memcpy(buffer + 12, &version, 2);
+			std::memcpy(buffer + 14, &element_kind, 2);
+			std::memcpy(buffer + 16, &element_size, 4);
+			std::memcpy(buffer + 20, &data_alignment, 4);
+			std::memcpy(buffer + 24, &row_count, 8);
+			std::memcpy(buffer + 32, &column_count, 8);
+		}
+
+		void read(const char* buffer)
+		{
+			std::uint32_t order;
+			std::uint16_t file_version;
+			if (std::memcmp(buffer, "ZAOLYMTX", 8) != 0)
+				throw matrix_file_error("Not a matrix file");
+			std::memcpy(&order, buffer + 8, 4);
+			if (order != byte_order && swap_bytes(order) != byte_order)
+				throw matrix_file_error("Not a matrix file");
+			swapped = order != byte_order;
+			std::memcpy(&file_version, buffer + 12, 2);
+			std::memcpy(&element_kind, buffer + 14, 2);
+			std::memcpy(&element_size, buffer + 16, 4);
+			std::memcpy(&data_alignment, buffer + 20, 4);
+			std::memcpy(&row_count, buffer + 24, 8);
+			std::memcpy(&column_count, buffer + 32, 8);
+			if (swapped)
+			{
+				file_version = swap_bytes(file_version);
+				element_kind = swap_bytes(element_kind);
+				element_size = swap_bytes(element_size);
+				data_alignment = swap_bytes(data_alignment);
+				row_count = swap_bytes(row_count);
+				column_count = swap_bytes(column_count);
+			}
+			if (file_version != version)
+				throw matrix_file_error("Unsupported matrix file version");
+			if (data_alignment == 0)
+				throw matrix_file_error("Corrupt matrix file header");
+		}
+
+		template <typename number>
+		void check() const // The stored elements must be exactly number
+		{
+			if (element_kind != matrix_file_element<number>::kind || element_size != sizeof(number))
+				throw matrix_file_error("Matrix file element type mismatch");
+			if (row_count == 0 || column_count == 0)
+				throw matrix_too_small();
+			if (column_count > std::uint64_t(-1) / sizeof(number) / row_count || row_count * column_count > size_t(-1) / sizeof(number))
+				throw matrix_file_error("Corrupt matrix file header");
+		}
+
+		static std::streamoff remaining(std::istream& is) // Bytes from the read position to the end, or -1 if the stream cannot seek
+		{
+			const std::streampos position = is.tellg();
+			if (position == std::streampos(-1))
+			{
+				is.clear(is.rdstate() & ~std::ios::failbit);
+				return -1;
+			}
+			is.seekg(0, std::ios::end);
+			const std::streampos end = is.tellg();
+			is.clear(is.rdstate() & ~std::ios::failbit);
+			is.seekg(position);
+			return end == std::streampos(-1) ? -1 : std::streamoff(end - position);
+		}
+
+		template <typename integer>
+		static integer swap_bytes(integer value)
+		{
+			char bytes[sizeof(integer)];
+			std::memcpy(bytes, &value, sizeof(integer));
+			std::reverse(bytes, bytes + sizeof(integer));
+			std::memcpy(&value, bytes, sizeof(integer));
+			return value;
+		}
+	};
+
+	template <typename number, typename allocator_type>
+	void save(const matrix<number, allocator_type>& matr, std::ostream& os)
+	{
+		matrix_file_header header;
+		header.element_kind = matrix_file_element<number>::kind;
+		header.element_size = sizeof(number);
+		header.row_count = matr.row_count();
+		header.column_count = matr.column_count();
+		char buffer[matrix_file_header::size];
+		header.write(buffer);
+		os.write(buffer, sizeof(buffer));
+		for (size_t offset = sizeof(buffer); offset < header.data_offset(); ++offset)
+			os.put(0);
+		if (matr.row_stride() == matr.column_count())
+			os.write(reinterpret_cast<const char*>(matr.data()), std::streamsize(matr.row_count() * matr.column_count() * sizeof(number)));
+		else // Row padding is not stored
+			for (size_t row_index = 0; row_index < matr.row_count(); ++row_index)
+				os.write(reinterpret_cast<const char*>(matr[row_index]), std::streamsize(matr.column_count() * sizeof(number)));
+		if (!os)
+			throw matrix_file_error("Cannot write matrix file");
+	}
+
+	template <typename number, typename allocator_type>
+	void save(const matrix<number, allocator_type>& matr, const std::string& path)
+	{
+		std::ofstream os(path, std::ios::binary);
+		if (!os)
+			throw matrix_file_error("Cannot open matrix file");
+		save(matr, os);
+	}
+
+	template <typename number, typename allocator_type = std::allocator<number>>
+	matrix<number, allocator_type> load_matrix(std::istream& is) // Reads straight into the matrix buffer, never holding a second copy of the data
+	{
+		char buffer[matrix_file_header::size];
+		matrix_file_header header;
+		if (!is.read(buffer, sizeof(buffer)))
+			throw matrix_file_error("Truncated matrix file");
+		header.read(buffer);
+		header.check<number>();
+		is.ignore(std::streamsize(header.data_offset() - sizeof(buffer)));
+		const size_t row_count = size_t(header.row_count), column_count = size_t(header.column_count);
+		const std::streamoff available = matrix_file_header::remaining(is);
+		if (available >= 0 && std::uint64_t(available) / sizeof(number) / column_count < row_count) // Checked before allocating, the header may be corrupt
+			throw matrix_file_error("Truncated matrix file");
+		const size_t chunk_rows = std::max<size_t>(1, matrix_file_header::first_chunk / sizeof(number) / column_count);
+		matrix<number, allocator_type> result(available >= 0 ? row_count : std::min(row_count, chunk_rows), column_count);
+		for (size_t loaded_rows = 0; loaded_rows < row_count;) // A stream of unknown length grows the matrix only as data arrives
+		{
+			if (loaded_rows == result.row_count())
+				result.resize(std::min(row_count, 2 * loaded_rows), column_count);
+			const size_t rows = result.row_count() - loaded_rows;
+			const bool packed = result.row_stride() == column_count; // One read for the whole block, otherwise one per row around the padding
+			for (size_t row_index = loaded_rows; row_index < (packed ? loaded_rows + 1 : result.row_count()); ++row_index)
+				if (!is.read(reinterpret_cast<char*>(result[row_index]), std::streamsize((packed ? rows : 1) * column_count * sizeof(number))))
+					throw matrix_file_error("Truncated matrix file");
+			loaded_rows = result.row_count();
+		}
+		if (header.swapped)
+			for (size_t row_index = 0; row_index < row_count; ++row_index)
+				for (size_t column_index = 0; column_index < column_count; ++column_index)
+					result[row_index][column_index] = matrix_file_header::swap_bytes(result[row_index][column_index]);
+		return result;
+	}
+
+	template <typename number, typename allocator_type = std::allocator<number>>
+	matrix<number, allocator_type> load_matrix(const std::string& path)
+	{
+		std::ifstream is(path, std::ios::binary);
+		if (!is)
+			throw matrix_file_error("Cannot open matrix file");
+		return load_matrix<number, allocator_type>(is);
+	}
+
+	template <typename number>
+	class mapped_matrix // Read-only matrix file mapped into memory, the elements are paged in on first touch and never copied
+	{
+	public:
+		explicit mapped_matrix(const std::string& path)
+		{
+			map(path);
+			try
+			{
+				matrix_file_header header;
+				if (_mapped_size < matrix_file_header::size)
+					throw matrix_file_error("Truncated matrix file");
+				header.read(static_cast<const char*>(_address));
+				header.check<number>();
+				if (header.swapped)
+					throw matrix_file_error("Matrix file byte order differs, use load_matrix");
+				if (_mapped_size < header.data_offset() || (_mapped_size - header.data_offset()) / sizeof(number) / header.column_count < header.row_count)
+					throw matrix_file_error("Truncated matrix file");
+				if (header.data_offset() % alignof(number) != 0)
+					throw matrix_file_error("Misaligned matrix file data");
+				_row_count = size_t(header.row_count);
+				_column_count = size_t(header.column_count);
+				_data = reinterpret_cast<const number*>(static_cast<const char*>(_address) + header.data_offset());
+			}
+			catch (...)
+			{
+				unmap();
+				throw;
+			}
+		}
+
+		mapped_matrix(const mapped_matrix&) = delete;
+
+		mapped_matrix(mapped_matrix&& other) noexcept
+		{
+			swap(other);
+		}
+
+		mapped_matrix& operator=(const mapped_matrix&) = delete;
+
+		mapped_matrix& operator=(mapped_matrix&& other) noexcept
+		{
+			mapped_matrix(std::move(other)).swap(*this);
+			return *this;
+		}
+
+		~mapped_matrix()
+		{
+			unmap();
+		}
+
+		size_t row_count() const
+		{
+			return _row_count;
+		}
+
+		size_t column_count() const
+		{
+			return _column_count;
+		}
+
+		const number* data() const
+		{
+			return _data;
+		}
+
+		matrix_view<const number> view() const
+		{
+			return matrix_view<const number>(_data, _row_count, _column_count, _column_count);
+		}
+
+		matrix<number> to_matrix() const // Copies the elements out, the result outlives the mapping
+		{
+			return matrix<number>(view());
+		}
+
+	private:
+		const void* _address = nullptr;
+		size_t _mapped_size{};
+		size_t _row_count{}, _column_count{};
+		const number* _data = nullptr;
+
+		void swap(mapped_matrix& other) noexcept
+		{
+			std::swap(_address, other._address);
+			std::swap(_mapped_size, other._mapped_size);
+			std::swap(_row_count, other._row_count);
+			std::swap(_column_count, other._column_count);
+			std::swap(_data, other._data);
+		}
+
+#if defined(_WIN32)
+		void map(const std::string& path)
+		{
+			const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				throw matrix_file_error("Cannot open matrix file");
+			LARGE_INTEGER file_size;
+			if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+			{
+				CloseHandle(file);
+				throw matrix_file_error("Truncated matrix file");
+			}
+			const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			CloseHandle(file);
+			if (mapping == nullptr)
+				throw matrix_file_error("Cannot map matrix file");
+			_address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping); // The view keeps the mapping alive
+			if (_address == nullptr)
+				throw matrix_file_error("Cannot map matrix file");
+			_mapped_size = size_t(file_size.QuadPart);
+		}
+
+		void unmap() noexcept
+		{
+			if (_address != nullptr)
+				UnmapViewOfFile(_address);
+			_address = nullptr;
+		}
+#else
+		void map(const std::string& path)
+		{
+			const int file = ::open(path.c_str(), O_RDONLY);
+			if (file < 0)
+				throw matrix_file_error("Cannot open matrix file");
+			struct stat status;
+			if (::fstat(file, &status) != 0 || status.st_size == 0)
+			{
+				::close(file);
+				throw matrix_file_error("Truncated matrix file");
+			}
+			void* address = ::mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+			::close(file); // The mapping keeps the file alive
+			if (address == MAP_FAILED)
+				throw matrix_file_error("Cannot map matrix file");
+			_address = address;
+			_mapped_size = size_t(status.st_size);
+		}
+
+		void unmap() noexcept
+		{
+			if (_address != nullptr)
+				::munmap(const_cast<void*>(_address), _mapped_size);
+			_address = nullptr;
+		}
+#endif
+	};
+
+	template <typename number>
+	mapped_matrix<number> map_matrix(const std::string& path)
+	{
+		return mapped_matrix<number>(path);
+	}
+}
@@ -1,6 +1,43 @@
 #pragma once
 
+#include "thread-pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX512F__)
+#define ZAOLY_GEMM_SIMD_BYTES 64
+#elif defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define ZAOLY_GEMM_SIMD_BYTES 32
+#else
+#define ZAOLY_GEMM_SIMD_BYTES 0
+#endif
+
+#if defined(__AVX__)
+#define ZAOLY_TRANSPOSE_SIMD_BYTES 32
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZAOLY_TRANSPOSE_SIMD_BYTES 16
+#else
+#define ZAOLY_TRANSPOSE_SIMD_BYTES 0
+#endif
+
+#if ZAOLY_GEMM_SIMD_BYTES > 0 || ZAOLY_TRANSPOSE_SIMD_BYTES > 0
+#include <immintrin.h>
+#endif
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
 
 namespace zaoly
 {
@@ -22,313 +59,2310 @@ namespace zaoly
 		subscript_out_of_range() : std::logic_error("Subscript out of range") {}
 	};
 
+	class matrix_singular : std::logic_error
+	{
+	public:
+		matrix_singular() : std::logic_error("Matrix singular") {}
+	};
+
+	class matrix_not_positive_definite : std::logic_error
+	{
+	public:
+		matrix_not_positive_definite() : std::logic_error("Matrix not positive definite") {}
+	};
+
+	template <typename number>
+	class lu_decomposition;
+
+	template <typename number>
+	class cholesky_decomposition;
+
+	template <typename number>
+	class bareiss_elimination;
+
+	template <typename d_type, typename s_type>
+	class rational;
+
+	template <typename number>
+	struct exact_elimination : std::is_integral<number> {}; // Element types whose determinant and inverse use Bareiss elimination instead of LU
+
+	template <typename d_type, typename s_type>
+	struct exact_elimination<rational<d_type, s_type>> : std::true_type {};
+
+	template <typename number, number modulo>
+	class modint;
+
+	template <typename number>
+	struct strassen_crossover : std::integral_constant<size_t, 0> {}; // Products whose dimensions all reach this are split by Strassen-Winograd, 0 always uses the classical kernel
+
+	template <typename d_type, typename s_type>
+	struct strassen_crossover<rational<d_type, s_type>> : std::integral_constant<size_t, 32> {}; // Every element operation reduces by a gcd, so the recursion pays off early
+
+	template <typename number, number modulo>
+	struct strassen_crossover<modint<number, modulo>> : std::integral_constant<size_t, 64> {}; // A multiply and a remainder against an add and a compare
+
+	template <typename number>
+	class simple_gemm_kernel // C += A * B on row-major buffers with leading dimensions, one row of C at a time
+	{
+	public:
+		static void multiply(size_t m, size_t n, size_t k, const number* a, size_t lda, const number* b, size_t ldb, number* c, size_t ldc)
+		{
+			for (size_t row_index = 0; row_index < m; ++row_index)
+			{
+				number* c_row = c + row_index * ldc;
+				for (size_t mid_index = 0; mid_index < k; ++mid_index)
+				{
+					const number a_element = a[row_index * lda + mid_index];
+					if (a_element == number{})
+						continue;
+					const number* b_row = b + mid_index * ldb;
+					for (size_t column_index = 0; column_index < n; ++column_index)
+						c_row[column_index] += a_element * b_row[column_index];
+				}
+			}
+		}
+	};
+
+#if ZAOLY_GEMM_SIMD_BYTES == 64
+	template <typename number>
+	struct gemm_simd;
+
+	template <>
+	struct gemm_simd<double>
+	{
+		using type = __m512d;
+		static type zero() { return _mm512_setzero_pd(); }
+		static type load(const double* p) { return _mm512_loadu_pd(p); }
+		static void store(double* p, type v) { _mm512_storeu_pd(p, v); }
+		static type broadcast(double x) { return _mm512_set1_pd(x); }
+		static type add(type x, type y) { return _mm512_add_pd(x, y); }
+		static type fmadd(type x, type y, type z) { return _mm512_fmadd_pd(x, y, z); }
+	};
+
+	template <>
+	struct gemm_simd<float>
+	{
+		using type = __m512;
+		static type zero() { return _mm512_setzero_ps(); }
+		static type load(const float* p) { return _mm512_loadu_ps(p); }
+		static void store(float* p, type v) { _mm512_storeu_ps(p, v); }
+		static type broadcast(float x) { return _mm512_set1_ps(x); }
+		static type add(type x, type y) { return _mm512_add_ps(x, y); }
+		static type fmadd(type x, type y, type z) { return _mm512_fmadd_ps(x, y, z); }
+	};
+#elif ZAOLY_GEMM_SIMD_BYTES == 32
 	template <typename number>
-	class matrix
+	struct gemm_simd;
+
+	template <>
+	struct gemm_simd<double>
+	{
+		using type = __m256d;
+		static type zero() { return _mm256_setzero_pd(); }
+		static type load(const double* p) { return _mm256_loadu_pd(p); }
+		static void store(double* p, type v) { _mm256_storeu_pd(p, v); }
+		static type broadcast(double x) { return _mm256_set1_pd(x); }
+		static type add(type x, type y) { return _mm256_add_pd(x, y); }
+		static type fmadd(type x, type y, type z) { return _mm256_fmadd_pd(x, y, z); }
+	};
+
+	template <>
+	struct gemm_simd<float>
 	{
-		using row_type    = std::initializer_list<number>;
-		using matrix_type = std::initializer_list<row_type>;
+		using type = __m256;
+		static type zero() { return _mm256_setzero_ps(); }
+		static type load(const float* p) { return _mm256_loadu_ps(p); }
+		static void store(float* p, type v) { _mm256_storeu_ps(p, v); }
+		static type broadcast(float x) { return _mm256_set1_ps(x); }
+		static type add(type x, type y) { return _mm256_add_ps(x, y); }
+		static type fmadd(type x, type y, type z) { return _mm256_fmadd_ps(x, y, z); }
+	};
+#endif
 
+	template <typename number>
+	class blocked_gemm_kernel // Packed panels in cache-sized blocks, register-blocked mr * nr micro-kernel (float and double)
+	{
 	public:
-		matrix(size_t row_count, size_t column_count, const matrix_type& nums = {}) :
-			_row_count(row_count), _column_count(column_count)
+#if ZAOLY_GEMM_SIMD_BYTES > 0
+		static constexpr size_t lanes = ZAOLY_GEMM_SIMD_BYTES / sizeof(number);
+		static constexpr size_t mr = 6, nr = 2 * lanes;
+#else
+		static constexpr size_t mr = 4, nr = 4;
+#endif
+		static constexpr size_t kc_block = 256, mc_block = 72, nc_block = 4096;
+		static constexpr size_t small_product = 32 * 32 * 32; // Below this, packing costs more than it saves
+
+		static void multiply(size_t m, size_t n, size_t k, const number* a, size_t lda, const number* b, size_t ldb, number* c, size_t ldc)
 		{
-			if (row_count <= 0 || column_count <= 0)
-				throw matrix_too_small();
-			_data = new number[_row_count * _column_count]{};
-			if (nums.begin() == nullptr)
+			if (m * n * k <= small_product)
+			{
+				simple_gemm_kernel<number>::multiply(m, n, k, a, lda, b, ldb, c, ldc);
 				return;
-			for (size_t row_index = 0; row_index < nums.size() && row_index < _row_count; ++row_index)
-				for (size_t column_index = 0; column_index < nums.begin()[row_index].size() && column_index < _column_count; ++column_index)
-					_data[row_index * _column_count + column_index] = nums.begin()[row_index].begin()[column_index];
+			}
+			thread_local std::vector<number> packed_a, packed_b;
+			for (size_t jc = 0; jc < n; jc += nc_block)
+			{
+				const size_t nc = std::min(nc_block, n - jc);
+				for (size_t pc = 0; pc < k; pc += kc_block)
+				{
+					const size_t kc = std::min(kc_block, k - pc);
+					pack_b(kc, nc, b + pc * ldb + jc, ldb, packed_b);
+					for (size_t ic = 0; ic < m; ic += mc_block)
+					{
+						const size_t mc = std::min(mc_block, m - ic);
+						pack_a(mc, kc, a + ic * lda + pc, lda, packed_a);
+						macro_kernel(mc, nc, kc, packed_a.data(), packed_b.data(), c + ic * ldc + jc, ldc);
+					}
+				}
+			}
 		}
 
-		matrix(const matrix_type& nums = {})
+		static void pack_a(size_t mc, size_t kc, const number* a, size_t lda, std::vector<number>& packed) // Panels of mr rows, column by column
 		{
-			if (nums.begin() == nullptr || nums.size() == 0)
-				throw matrix_too_small();
-			_row_count = nums.size();
-			_column_count = nums.begin()->size();
-			for (size_t row_index = 1; row_index < _row_count; ++row_index)
-				if (nums.begin()[row_index].size() != _column_count)
-					throw matrix_unaligned();
-			_data = new number[_row_count * _column_count];
-			for (size_t row_index = 0; row_index < _row_count; ++row_index)
-				for (size_t column_index = 0; column_index < _column_count; ++column_index)
-					_data[row_index * _column_count + column_index] = nums.begin()[row_index].begin()[column_index];
+			const size_t panels = (mc + mr - 1) / mr;
+			if (packed.size() < panels * mr * kc)
+				packed.resize(panels * mr * kc);
+			number* dest = packed.data();
+			for (size_t panel = 0; panel < panels; ++panel)
+			{
+				const size_t rows = std::min(mr, mc - panel * mr);
+				const number* src = a + panel * mr * lda;
+				for (size_t mid_index = 0; mid_index < kc; ++mid_index)
+				{
+					size_t row_index = 0;
+					for (; row_index < rows; ++row_index)
+						*dest++ = src[row_index * lda + mid_index];
+					for (; row_index < mr; ++row_index)
+						*dest++ = number{};
+				}
+			}
 		}
 
-		matrix(const matrix& matr)
+		static void pack_b(size_t kc, size_t nc, const number* b, size_t ldb, std::vector<number>& packed) // Panels of nr columns, row by row
 		{
-			copy_assign(matr);
+			const size_t panels = (nc + nr - 1) / nr;
+			if (packed.size() < panels * nr * kc)
+				packed.resize(panels * nr * kc);
+			number* dest = packed.data();
+			for (size_t panel = 0; panel < panels; ++panel)
+			{
+				const size_t columns = std::min(nr, nc - panel * nr);
+				const number* src = b + panel * nr;
+				for (size_t mid_index = 0; mid_index < kc; ++mid_index)
+				{
+					size_t column_index = 0;
+					for (; column_index < columns; ++column_index)
+						*dest++ = src[mid_index * ldb + column_index];
+					for (; column_index < nr; ++column_index)
+						*dest++ = number{};
+				}
+			}
 		}
 
-		matrix(matrix&& matr) noexcept
+		static void macro_kernel(size_t mc, size_t nc, size_t kc, const number* packed_a, const number* packed_b, number* c, size_t ldc)
 		{
-			move_assign(std::move(matr));
+			for (size_t jr = 0; jr < nc; jr += nr)
+			{
+				const size_t columns = std::min(nr, nc - jr);
+				for (size_t ir = 0; ir < mc; ir += mr)
+				{
+					const size_t rows = std::min(mr, mc - ir);
+					number* c_tile = c + ir * ldc + jr;
+					if (rows == mr && columns == nr)
+						micro_kernel(kc, packed_a + ir * kc, packed_b + jr * kc, c_tile, ldc);
+					else
+					{
+						number edge[mr * nr]{};
+						micro_kernel(kc, packed_a + ir * kc, packed_b + jr * kc, edge, nr);
+						for (size_t row_index = 0; row_index < rows; ++row_index)
+							for (size_t column_index = 0; column_index < columns; ++column_index)
+								c_tile[row_index * ldc + column_index] += edge[row_index * nr + column_index];
+					}
+				}
+			}
 		}
 
-		~matrix()
+		static void micro_kernel(size_t kc, const number* a, const number* b, number* c, size_t ldc) // C(mr * nr) += packed A * packed B
 		{
-			delete[] _data;
+#if ZAOLY_GEMM_SIMD_BYTES > 0
+			using simd = gemm_simd<number>;
+			typename simd::type accumulator[mr][2];
+			for (size_t row_index = 0; row_index < mr; ++row_index)
+				accumulator[row_index][0] = accumulator[row_index][1] = simd::zero();
+			for (size_t mid_index = 0; mid_index < kc; ++mid_index, a += mr, b += nr)
+			{
+				const typename simd::type b0 = simd::load(b), b1 = simd::load(b + lanes);
+				for (size_t row_index = 0; row_index < mr; ++row_index)
+				{
+					const typename simd::type a_element = simd::broadcast(a[row_index]);
+					accumulator[row_index][0] = simd::fmadd(a_element, b0, accumulator[row_index][0]);
+					accumulator[row_index][1] = simd::fmadd(a_element, b1, accumulator[row_index][1]);
+				}
+			}
+			for (size_t row_index = 0; row_index < mr; ++row_index)
+			{
+				number* c_row = c + row_index * ldc;
+				simd::store(c_row, simd::add(simd::load(c_row), accumulator[row_index][0]));
+				simd::store(c_row + lanes, simd::add(simd::load(c_row + lanes), accumulator[row_index][1]));
+			}
+#else
+			number accumulator[mr][nr]{};
+			for (size_t mid_index = 0; mid_index < kc; ++mid_index, a += mr, b += nr)
+				for (size_t row_index = 0; row_index < mr; ++row_index)
+					for (size_t column_index = 0; column_index < nr; ++column_index)
+						accumulator[row_index][column_index] += a[row_index] * b[column_index];
+			for (size_t row_index = 0; row_index < mr; ++row_index)
+				for (size_t column_index = 0; column_index < nr; ++column_index)
+					c[row_index * ldc + column_index] += accumulator[row_index][column_index];
+#endif
 		}
+	};
 
-		size_t row_count() const
+	// Out-of-class definitions, the constants are bound to references by std::min
+	template <typename number>
+	constexpr size_t blocked_gemm_kernel<number>::mr;
+
+	template <typename number>
+	constexpr size_t blocked_gemm_kernel<number>::nr;
+
+	template <typename number>
+	constexpr size_t blocked_gemm_kernel<number>::kc_block;
+
+	template <typename number>
+	constexpr size_t blocked_gemm_kernel<number>::mc_block;
+
+	template <typename number>
+	constexpr size_t blocked_gemm_kernel<number>::nc_block;
+
+	template <typename number>
+	class strassen_gemm_kernel // Strassen-Winograd recursion, 7 half-size products and 15 additions per level, down to the classical kernel
+	{
+	public:
+		static std::atomic<size_t> crossover; // Starts at strassen_crossover<number>, may be retuned at run time; every product reads it once
+
+		static void multiply(size_t m, size_t n, size_t k, const number* a, size_t lda, const number* b, size_t ldb, number* c, size_t ldc) // C += A * B
 		{
-			return _row_count;
+			const size_t cutoff = crossover.load(std::memory_order_relaxed);
+			if (!splits(m, n, k, cutoff))
+			{
+				simple_gemm_kernel<number>::multiply(m, n, k, a, lda, b, ldb, c, ldc);
+				return;
+			}
+			thread_local std::vector<number> workspace; // Slices for every level of the recursion, kept between products
+			const size_t workspace_size = level_workspace(m, n, k, cutoff);
+			if (workspace.size() < workspace_size)
+				workspace.resize(workspace_size);
+			recurse(m, n, k, a, lda, b, ldb, c, ldc, cutoff, workspace.data());
 		}
 
-		size_t column_count() const
+	private:
+		static bool splits(size_t m, size_t n, size_t k, size_t cutoff)
 		{
-			return _column_count;
+			return cutoff != 0 && m >= std::max<size_t>(cutoff, 2) && n >= std::max<size_t>(cutoff, 2) && k >= std::max<size_t>(cutoff, 2);
 		}
 
-		void resize(size_t new_row_count, size_t new_column_count)
+		static size_t level_workspace(size_t m, size_t n, size_t k, size_t cutoff) // Elements of workspace used by this level and all levels below
 		{
-			if (new_row_count <= 0 || new_column_count <= 0)
-				throw matrix_too_small();
-			matrix result(new_row_count, new_column_count);
-			for (size_t row_index = 0; row_index < _row_count && row_index < new_row_count; ++row_index)
-				for (size_t column_index = 0; column_index < _column_count && column_index < new_column_count; ++column_index)
-					result.data(row_index, column_index) = data(row_index, column_index);
-			*this = std::move(result);
+			size_t result = 0;
+			for (; splits(m, n, k, cutoff); m /= 2, n /= 2, k /= 2)
+				result += (m / 2) * (k / 2) + (k / 2) * (n / 2) + 3 * (m / 2) * (n / 2);
+			return result;
 		}
 
-		number* data()
+		static void recurse(size_t m, size_t n, size_t k, const number* a, size_t lda, const number* b, size_t ldb, number* c, size_t ldc, size_t cutoff, number* workspace)
 		{
-			return _data;
+			if (!splits(m, n, k, cutoff))
+			{
+				simple_gemm_kernel<number>::multiply(m, n, k, a, lda, b, ldb, c, ldc);
+				return;
+			}
+			const size_t mh = m / 2, nh = n / 2, kh = k / 2;
+			const number* a11 = a, * a12 = a + kh, * a21 = a + mh * lda, * a22 = a21 + kh;
+			const number* b11 = b, * b12 = b + nh, * b21 = b + kh * ldb, * b22 = b21 + nh;
+			number* c11 = c, * c12 = c + nh, * c21 = c + mh * ldc, * c22 = c21 + nh;
+			number* x = workspace, * y = x + mh * kh, * p = y + kh * nh, * q = p + mh * nh, * r = q + mh * nh;
+			number* const below = r + mh * nh; // The half-size products use the rest
+			std::fill(p, below, number{}); // P, Q and R are accumulated into
+
+			recurse(mh, nh, kh, a11, lda, b11, ldb, r, nh, cutoff, below); // R = P1
+			combine(mh, nh, c11, ldc, c11, ldc, r, nh, false);
+			recurse(mh, nh, kh, a12, lda, b21, ldb, c11, ldc, cutoff, below); // C11 = P1 + P2
+			combine(mh, kh, x, kh, a11, lda, a21, lda, true); // S3
+			combine(kh, nh, y, nh, b22, ldb, b12, ldb, true); // T3
+			recurse(mh, nh, kh, x, kh, y, nh, q, nh, cutoff, below); // Q = P7
+			combine(mh, kh, x, kh, a21, lda, a22, lda, false); // S1
+			combine(kh, nh, y, nh, b12, ldb, b11, ldb, true); // T1
+			recurse(mh, nh, kh, x, kh, y, nh, p, nh, cutoff, below); // P = P5
+			combine(mh, kh, x, kh, x, kh, a11, lda, true); // S2 = S1 - A11
+			combine(kh, nh, y, nh, b22, ldb, y, nh, true); // T2 = B22 - T1
+			recurse(mh, nh, kh, x, kh, y, nh, r, nh, cutoff, below); // R = P1 + P6
+			combine(mh, nh, c12, ldc, c12, ldc, r, nh, false);
+			combine(mh, nh, c12, ldc, c12, ldc, p, nh, false);
+			combine(mh, kh, x, kh, a12, lda, x, kh, true); // S4 = A12 - S2
+			recurse(mh, nh, kh, x, kh, b22, ldb, c12, ldc, cutoff, below); // C12 = P1 + P6 + P5 + P3
+			combine(kh, nh, y, nh, b21, ldb, y, nh, true); // -T4 = B21 - T2
+			recurse(mh, nh, kh, a22, lda, y, nh, c21, ldc, cutoff, below); // C21 = -P4
+			combine(mh, nh, r, nh, r, nh, q, nh, false); // R = P1 + P6 + P7
+			combine(mh, nh, c21, ldc, c21, ldc, r, nh, false); // C21 = P1 + P6 + P7 - P4
+			combine(mh, nh, c22, ldc, c22, ldc, r, nh, false);
+			combine(mh, nh, c22, ldc, c22, ldc, p, nh, false); // C22 = P1 + P6 + P7 + P5
+
+			// Odd dimensions leave a last row, column or inner index outside the recursion
+			if (k > 2 * kh)
+				simple_gemm_kernel<number>::multiply(2 * mh, 2 * nh, 1, a + 2 * kh, lda, b + 2 * kh * ldb, ldb, c, ldc);
+			if (n > 2 * nh)
+				simple_gemm_kernel<number>::multiply(2 * mh, 1, k, a, lda, b + 2 * nh, ldb, c + 2 * nh, ldc);
+			if (m > 2 * mh)
+				simple_gemm_kernel<number>::multiply(1, n, k, a + 2 * mh * lda, lda, b, ldb, c + 2 * mh * ldc, ldc);
 		}
 
-		const number* data() const
+		static void combine(size_t rows, size_t columns, number* dest, size_t ldd, const number* x, size_t ldx, const number* y, size_t ldy, bool subtract) // D = X + Y or X - Y, D may be X or Y
 		{
-			return _data;
+			for (size_t row_index = 0; row_index < rows; ++row_index)
+			{
+				number* d_row = dest + row_index * ldd;
+				const number* x_row = x + row_index * ldx, * y_row = y + row_index * ldy;
+				if (subtract)
+					for (size_t column_index = 0; column_index < columns; ++column_index)
+						d_row[column_index] = x_row[column_index] - y_row[column_index];
+				else
+					for (size_t column_index = 0; column_index < columns; ++column_index)
+						d_row[column_index] = x_row[column_index] + y_row[column_index];
+			}
 		}
+	};
 
-		number& data(size_t row_index, size_t column_index)
+	template <typename number>
+	std::atomic<size_t> strassen_gemm_kernel<number>::crossover{strassen_crossover<number>::value};
+
+	template <typename number>
+	class gemm_kernel : public strassen_gemm_kernel<number> {}; // Generic element types, classical unless strassen_crossover says otherwise
+
+	template <>
+	class gemm_kernel<double> : public blocked_gemm_kernel<double> {};
+
+	template <>
+	class gemm_kernel<float> : public blocked_gemm_kernel<float> {};
+
+	template <typename number>
+	struct transpose_tile // Square tile transposed in registers, generic types have none and go element by element
+	{
+		static constexpr size_t size = 1;
+
+		static void transpose(const number* a, size_t, number* b, size_t)
 		{
-			if (row_index >= _row_count || column_index >= _column_count)
-				throw subscript_out_of_range();
-			else
-				return _data[row_index * _column_count + column_index];
+			*b = *a;
 		}
+	};
 
-		const number& data(size_t row_index, size_t column_index) const
+#if ZAOLY_TRANSPOSE_SIMD_BYTES == 32
+	template <>
+	struct transpose_tile<float>
+	{
+		static constexpr size_t size = 8;
+
+		static void transpose(const float* a, size_t lda, float* b, size_t ldb)
 		{
-			if (row_index >= _row_count || column_index >= _column_count)
-				throw subscript_out_of_range();
-			else
-				return _data[row_index * _column_count + column_index];
+			const __m256 r0 = _mm256_loadu_ps(a), r1 = _mm256_loadu_ps(a + lda), r2 = _mm256_loadu_ps(a + 2 * lda), r3 = _mm256_loadu_ps(a + 3 * lda);
+			const __m256 r4 = _mm256_loadu_ps(a + 4 * lda), r5 = _mm256_loadu_ps(a + 5 * lda), r6 = _mm256_loadu_ps(a + 6 * lda), r7 = _mm256_loadu_ps(a + 7 * lda);
+			const __m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1), t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+			const __m256 t4 = _mm256_unpacklo_ps(r4, r5), t5 = _mm256_unpackhi_ps(r4, r5), t6 = _mm256_unpacklo_ps(r6, r7), t7 = _mm256_unpackhi_ps(r6, r7);
+			const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)), s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+			const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)), s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+			const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0)), s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+			const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0)), s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+			_mm256_storeu_ps(b, _mm256_permute2f128_ps(s0, s4, 0x20));
+			_mm256_storeu_ps(b + ldb, _mm256_permute2f128_ps(s1, s5, 0x20));
+			_mm256_storeu_ps(b + 2 * ldb, _mm256_permute2f128_ps(s2, s6, 0x20));
+			_mm256_storeu_ps(b + 3 * ldb, _mm256_permute2f128_ps(s3, s7, 0x20));
+			_mm256_storeu_ps(b + 4 * ldb, _mm256_permute2f128_ps(s0, s4, 0x31));
+			_mm256_storeu_ps(b + 5 * ldb, _mm256_permute2f128_ps(s1, s5, 0x31));
+			_mm256_storeu_ps(b + 6 * ldb, _mm256_permute2f128_ps(s2, s6, 0x31));
+			_mm256_storeu_ps(b + 7 * ldb, _mm256_permute2f128_ps(s3, s7, 0x31));
 		}
+	};
 
-		matrix transpose() const
+	template <>
+	struct transpose_tile<double>
+	{
+		static constexpr size_t size = 4;
+
+		static void transpose(const double* a, size_t lda, double* b, size_t ldb)
 		{
-			matrix result(_column_count, _row_count);
-			for (size_t row_index = 0; row_index < _row_count; ++row_index)
-				for (size_t column_index = 0; column_index < _column_count; ++column_index)
-					result.data(column_index, row_index) = data(row_index, column_index);
-			return result;
+			const __m256d r0 = _mm256_loadu_pd(a), r1 = _mm256_loadu_pd(a + lda), r2 = _mm256_loadu_pd(a + 2 * lda), r3 = _mm256_loadu_pd(a + 3 * lda);
+			const __m256d t0 = _mm256_unpacklo_pd(r0, r1), t1 = _mm256_unpackhi_pd(r0, r1), t2 = _mm256_unpacklo_pd(r2, r3), t3 = _mm256_unpackhi_pd(r2, r3);
+			_mm256_storeu_pd(b, _mm256_permute2f128_pd(t0, t2, 0x20));
+			_mm256_storeu_pd(b + ldb, _mm256_permute2f128_pd(t1, t3, 0x20));
+			_mm256_storeu_pd(b + 2 * ldb, _mm256_permute2f128_pd(t0, t2, 0x31));
+			_mm256_storeu_pd(b + 3 * ldb, _mm256_permute2f128_pd(t1, t3, 0x31));
 		}
+	};
+#elif ZAOLY_TRANSPOSE_SIMD_BYTES == 16
+	template <>
+	struct transpose_tile<float>
+	{
+		static constexpr size_t size = 4;
 
-		matrix minor(size_t row_index, size_t column_index) const
+		static void transpose(const float* a, size_t lda, float* b, size_t ldb)
 		{
-			matrix result(_row_count - 1, _column_count - 1);
-			size_t new_row_index{}, new_column_index{};
-			for (size_t old_row_index = 0; old_row_index < _row_count; ++old_row_index)
-			{
-				if (old_row_index == row_index)
-					continue;
-				new_column_index = 0;
-				for (size_t old_column_index = 0; old_column_index < _column_count; ++old_column_index)
-				{
-					if (old_column_index == column_index)
-						continue;
-					result.data(new_row_index, new_column_index) = data(old_row_index, old_column_index);
-					++new_column_index;
-				}
-				++new_row_index;
-			}
-			return result;
+			__m128 r0 = _mm_loadu_ps(a), r1 = _mm_loadu_ps(a + lda), r2 = _mm_loadu_ps(a + 2 * lda), r3 = _mm_loadu_ps(a + 3 * lda);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(b, r0);
+			_mm_storeu_ps(b + ldb, r1);
+			_mm_storeu_ps(b + 2 * ldb, r2);
+			_mm_storeu_ps(b + 3 * ldb, r3);
 		}
+	};
 
-		number cofactor(size_t row_index, size_t column_index) const
+	template <>
+	struct transpose_tile<double>
+	{
+		static constexpr size_t size = 2;
+
+		static void transpose(const double* a, size_t lda, double* b, size_t ldb)
 		{
-			if (row_index % 2 == column_index % 2)
-				return minor(row_index, column_index).determinant();
+			const __m128d r0 = _mm_loadu_pd(a), r1 = _mm_loadu_pd(a + lda);
+			_mm_storeu_pd(b, _mm_unpacklo_pd(r0, r1));
+			_mm_storeu_pd(b + ldb, _mm_unpackhi_pd(r0, r1));
+		}
+	};
+#endif
+
+	template <typename number>
+	class transpose_kernel // B = A^T on row-major buffers with leading dimensions, halving the longer side until both blocks fit in L1
+	{
+	public:
+		static constexpr size_t tile = transpose_tile<number>::size;
+		static constexpr size_t leaf = 32; // Divisible by every tile size
+
+		static void transpose(size_t m, size_t n, const number* a, size_t lda, number* b, size_t ldb) // A is m * n
+		{
+			if (m <= leaf && n <= leaf)
+				transpose_leaf(m, n, a, lda, b, ldb);
+			else if (m >= n)
+			{
+				const size_t half = split(m);
+				transpose(half, n, a, lda, b, ldb);
+				transpose(m - half, n, a + half * lda, lda, b + half, ldb);
+			}
 			else
-				return -minor(row_index, column_index).determinant();
+			{
+				const size_t half = split(n);
+				transpose(m, half, a, lda, b, ldb);
+				transpose(m, n - half, a + half, lda, b + half * ldb, ldb);
+			}
 		}
 
-		number determinant() const
+		static void transpose_in_place(size_t n, number* a, size_t lda) // A is n * n, diagonal blocks recurse, off-diagonal blocks swap with each other
 		{
-			number single_element{}, result{};
-			if (_row_count != _column_count)
-				throw matrix_unaligned();
-			else if (_row_count == 1)
-				return data(0, 0);
-			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+			if (n <= leaf)
 			{
-				single_element = data(row_index, 0);
-				if (single_element != 0.0)
-					result += single_element * cofactor(row_index, 0);
+				transpose_in_place_leaf(n, a, lda);
+				return;
 			}
-			return result;
+			const size_t half = split(n);
+			transpose_in_place(half, a, lda);
+			transpose_in_place(n - half, a + half * lda + half, lda);
+			swap_transposed(half, n - half, a + half, a + half * lda, lda);
 		}
 
-		matrix adjoint() const
+	private:
+		static size_t split(size_t size) // Halves stay multiples of the tile so that only the last block has a ragged edge
 		{
-			matrix result(_row_count, _column_count);
-			for (size_t row_index = 0; row_index < _row_count; ++row_index)
-				for (size_t column_index = 0; column_index < _column_count; ++column_index)
-					result.data(row_index, column_index) = cofactor(row_index, column_index);
-			return result;
+			return (size / 2 + tile - 1) / tile * tile;
 		}
 
-		matrix adjoint_transpose() const
+		static void transpose_leaf(size_t m, size_t n, const number* a, size_t lda, number* b, size_t ldb)
 		{
-			return transpose().adjoint();
+			const size_t full_rows = m / tile * tile, full_columns = n / tile * tile;
+			for (size_t row_index = 0; row_index < full_rows; row_index += tile)
+				for (size_t column_index = 0; column_index < full_columns; column_index += tile)
+					transpose_tile<number>::transpose(a + row_index * lda + column_index, lda, b + column_index * ldb + row_index, ldb);
+			for (size_t row_index = 0; row_index < m; ++row_index)
+				for (size_t column_index = row_index < full_rows ? full_columns : 0; column_index < n; ++column_index)
+					b[column_index * ldb + row_index] = a[row_index * lda + column_index];
 		}
 
-		bool invertible() const
+		static void swap_tiles(number* x, number* y, size_t ld) // x <- y^T and y <- x^T for two disjoint tiles
 		{
-			return determinant() != 0.0;
+			number buffer[tile * tile];
+			transpose_tile<number>::transpose(x, ld, buffer, tile);
+			transpose_tile<number>::transpose(y, ld, x, ld);
+			for (size_t row_index = 0; row_index < tile; ++row_index)
+				std::copy(buffer + row_index * tile, buffer + row_index * tile + tile, y + row_index * ld);
 		}
 
-		matrix inverse() const
+		static void swap_transposed(size_t m, size_t n, number* x, number* y, size_t ld) // Exchanges X (m * n) with Y^T (Y is n * m)
 		{
-			matrix result = adjoint_transpose();
-			number det = determinant();
-			for (size_t row_index = 0; row_index < _row_count; ++row_index)
-				for (size_t column_index = 0; column_index < _column_count; ++column_index)
-					result.data(row_index, column_index) /= det;
-			return result;
+			if (m <= leaf && n <= leaf)
+			{
+				const size_t full_rows = m / tile * tile, full_columns = n / tile * tile;
+				for (size_t row_index = 0; row_index < full_rows; row_index += tile)
+					for (size_t column_index = 0; column_index < full_columns; column_index += tile)
+						swap_tiles(x + row_index * ld + column_index, y + column_index * ld + row_index, ld);
+				for (size_t row_index = 0; row_index < m; ++row_index)
+					for (size_t column_index = row_index < full_rows ? full_columns : 0; column_index < n; ++column_index)
+						std::swap(x[row_index * ld + column_index], y[column_index * ld + row_index]);
+			}
+			else if (m >= n)
+			{
+				const size_t half = split(m);
+				swap_transposed(half, n, x, y, ld);
+				swap_transposed(m - half, n, x + half * ld, y + half, ld);
+			}
+			else
+			{
+				const size_t half = split(n);
+				swap_transposed(m, half, x, y, ld);
+				swap_transposed(m, n - half, x + half, y + half * ld, ld);
+			}
 		}
 
-		void print(std::ostream& os = std::cout, const char* delimeter1 = " ", const char* delimeter2 = "\n") const
+		static void transpose_in_place_leaf(size_t n, number* a, size_t lda)
 		{
-			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+			const size_t full = n / tile * tile;
+			for (size_t row_index = 0; row_index < full; row_index += tile)
 			{
-				if (row_index > 0)
-					os << delimeter2;
-				for (size_t column_index = 0; column_index < _column_count; ++column_index)
-				{
-					if (column_index > 0)
-						os << delimeter1;
-					os << data(row_index, column_index);
-				}
+				number buffer[tile * tile];
+				number* diagonal = a + row_index * lda + row_index;
+				transpose_tile<number>::transpose(diagonal, lda, buffer, tile);
+				for (size_t index = 0; index < tile; ++index)
+					std::copy(buffer + index * tile, buffer + index * tile + tile, diagonal + index * lda);
+				for (size_t column_index = row_index + tile; column_index < full; column_index += tile)
+					swap_tiles(a + row_index * lda + column_index, a + column_index * lda + row_index, lda);
 			}
+			for (size_t row_index = 0; row_index < n; ++row_index)
+				for (size_t column_index = std::max(row_index + 1, full); column_index < n; ++column_index)
+					std::swap(a[row_index * lda + column_index], a[column_index * lda + row_index]);
 		}
+	};
 
-		template <typename number>
-		friend matrix<number> operator+(const matrix<number>& a, const matrix<number>& b);
+	template <typename number, size_t alignment = 64>
+	class aligned_allocator // Every block starts on an alignment-byte boundary, matrices using it also pad their rows to that boundary
+	{
+	public:
+		using value_type = number;
 
-		template <typename number>
-		friend matrix<number> operator-(const matrix<number>& a, const matrix<number>& b);
+		template <typename other_type>
+		struct rebind
+		{
+			using other = aligned_allocator<other_type, alignment>;
+		};
 
-		template <typename number>
-		friend matrix<number> operator*(const matrix<number>& a, const matrix<number>& b);
+		aligned_allocator() noexcept {}
 
-		template <typename number>
-		friend matrix<number> operator/(const matrix<number>& a, const matrix<number>& b);
+		template <typename other_type>
+		aligned_allocator(const aligned_allocator<other_type, alignment>&) noexcept {}
 
-		matrix& operator=(const matrix& matr)
+		number* allocate(size_t count)
 		{
-			copy_assign(matr);
-			return *this;
+			if (count > (size_t(-1) - alignment) / sizeof(number))
+				throw std::bad_alloc();
+			const size_t bytes = (count * sizeof(number) + alignment - 1) / alignment * alignment;
+#if defined(_WIN32)
+			void* result = _aligned_malloc(bytes, alignment);
+#else
+			void* result = nullptr;
+			if (posix_memalign(&result, alignment, bytes) != 0)
+				result = nullptr;
+#endif
+			if (result == nullptr)
+				throw std::bad_alloc();
+			return static_cast<number*>(result);
 		}
 
-		matrix& operator=(matrix&& matr) noexcept
+		void deallocate(number* pointer, size_t) noexcept
 		{
-			move_assign(std::move(matr));
-			return *this;
+#if defined(_WIN32)
+			_aligned_free(pointer);
+#else
+			free(pointer);
+#endif
 		}
 
-		number* operator[](size_t row_index)
+		friend bool operator==(const aligned_allocator&, const aligned_allocator&)
 		{
-			return _data + row_index * _column_count;
+			return true;
 		}
 
-		const number* operator[](size_t row_index) const
+		friend bool operator!=(const aligned_allocator&, const aligned_allocator&)
 		{
-			return _data + row_index * _column_count;
+			return false;
 		}
+	};
 
-		number& operator()(size_t row_index, size_t column_index)
-		{
-			return data(row_index, column_index);
-		}
+	template <typename allocator_type>
+	struct matrix_row_alignment : std::integral_constant<size_t, 0> {}; // Byte boundary every matrix row starts on, 0 keeps rows packed
 
-		const number& operator()(size_t row_index, size_t column_index) const
-		{
-			return data(row_index, column_index);
-		}
+	template <typename number, size_t alignment>
+	struct matrix_row_alignment<aligned_allocator<number, alignment>> : std::integral_constant<size_t, alignment> {};
 
-	private:
-		size_t _row_count, _column_count;
-		number* _data;
+	template <typename number, typename allocator_type = std::allocator<number>>
+	class matrix;
 
-		void copy_assign(const matrix& matr)
+	template <typename number>
+	using aligned_matrix = matrix<number, aligned_allocator<number>>; // 64-byte aligned rows, a whole number of cache lines apart
+
+	template <typename derived>
+	class matrix_expression // Element-wise expression evaluated lazily, in a single pass, when assigned to a matrix
+	{
+	public:
+		const derived& self() const
+		{
+			return static_cast<const derived&>(*this);
+		}
+	};
+
+	template <typename expression_type>
+	struct matrix_operand // Matrices are held by reference, intermediate expressions by value so that they may outlive the full-expression
+	{
+		using type = const expression_type;
+	};
+
+	template <typename number, typename allocator_type>
+	struct matrix_operand<matrix<number, allocator_type>>
+	{
+		using type = const matrix<number, allocator_type>&;
+	};
+
+	template <typename lhs_type, typename rhs_type, typename operation>
+	class matrix_binary_expression : public matrix_expression<matrix_binary_expression<lhs_type, rhs_type, operation>>
+	{
+	public:
+		using value_type = typename lhs_type::value_type;
+
+		matrix_binary_expression(const lhs_type& lhs, const rhs_type& rhs) : _lhs(lhs), _rhs(rhs)
+		{
+			if (lhs.row_count() != rhs.row_count() || lhs.column_count() != rhs.column_count())
+				throw matrix_unaligned();
+		}
+
+		size_t row_count() const
+		{
+			return _lhs.row_count();
+		}
+
+		size_t column_count() const
+		{
+			return _lhs.column_count();
+		}
+
+		value_type element(size_t row_index, size_t column_index) const
+		{
+			return operation()(_lhs.element(row_index, column_index), _rhs.element(row_index, column_index));
+		}
+
+		bool overlaps(const void* begin, const void* end) const // Whether an operand reads storage in [begin, end)
+		{
+			return _lhs.overlaps(begin, end) || _rhs.overlaps(begin, end);
+		}
+
+	private:
+		typename matrix_operand<lhs_type>::type _lhs;
+		typename matrix_operand<rhs_type>::type _rhs;
+	};
+
+	template <typename expression_type, typename operation>
+	class matrix_scalar_expression : public matrix_expression<matrix_scalar_expression<expression_type, operation>>
+	{
+	public:
+		using value_type = typename expression_type::value_type;
+
+		matrix_scalar_expression(const expression_type& expression, const value_type& scalar) : _expression(expression), _scalar(scalar) {}
+
+		size_t row_count() const
+		{
+			return _expression.row_count();
+		}
+
+		size_t column_count() const
+		{
+			return _expression.column_count();
+		}
+
+		value_type element(size_t row_index, size_t column_index) const
+		{
+			return operation()(_expression.element(row_index, column_index), _scalar);
+		}
+
+		bool overlaps(const void* begin, const void* end) const
+		{
+			return _expression.overlaps(begin, end);
+		}
+
+	private:
+		typename matrix_operand<expression_type>::type _expression;
+		value_type _scalar;
+	};
+
+	template <typename expression_type>
+	class matrix_negate_expression : public matrix_expression<matrix_negate_expression<expression_type>>
+	{
+	public:
+		using value_type = typename expression_type::value_type;
+
+		matrix_negate_expression(const expression_type& expression) : _expression(expression) {}
+
+		size_t row_count() const
+		{
+			return _expression.row_count();
+		}
+
+		size_t column_count() const
+		{
+			return _expression.column_count();
+		}
+
+		value_type element(size_t row_index, size_t column_index) const
+		{
+			return -_expression.element(row_index, column_index);
+		}
+
+		bool overlaps(const void* begin, const void* end) const
+		{
+			return _expression.overlaps(begin, end);
+		}
+
+	private:
+		typename matrix_operand<expression_type>::type _expression;
+	};
+
+	template <typename number>
+	class matrix_view_iterator // Visits the elements of a view in row-major order
+	{
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type        = typename std::remove_const<number>::type;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = number*;
+		using reference         = number&;
+
+		matrix_view_iterator() {}
+
+		matrix_view_iterator(number* base, size_t column_count, size_t row_stride, size_t column_stride, size_t index) :
+			_base(base), _column_count(column_count), _row_stride(row_stride), _column_stride(column_stride), _index(index) {}
+
+		reference operator*() const
+		{
+			return _base[_index / _column_count * _row_stride + _index % _column_count * _column_stride];
+		}
+
+		pointer operator->() const
+		{
+			return &**this;
+		}
+
+		reference operator[](difference_type offset) const
+		{
+			return *(*this + offset);
+		}
+
+		matrix_view_iterator& operator++()
+		{
+			++_index;
+			return *this;
+		}
+
+		matrix_view_iterator operator++(int)
+		{
+			matrix_view_iterator result = *this;
+			++_index;
+			return result;
+		}
+
+		matrix_view_iterator& operator--()
+		{
+			--_index;
+			return *this;
+		}
+
+		matrix_view_iterator operator--(int)
+		{
+			matrix_view_iterator result = *this;
+			--_index;
+			return result;
+		}
+
+		matrix_view_iterator& operator+=(difference_type offset)
+		{
+			_index += offset;
+			return *this;
+		}
+
+		matrix_view_iterator& operator-=(difference_type offset)
+		{
+			_index -= offset;
+			return *this;
+		}
+
+		friend matrix_view_iterator operator+(matrix_view_iterator iter, difference_type offset)
+		{
+			return iter += offset;
+		}
+
+		friend matrix_view_iterator operator+(difference_type offset, matrix_view_iterator iter)
+		{
+			return iter += offset;
+		}
+
+		friend matrix_view_iterator operator-(matrix_view_iterator iter, difference_type offset)
+		{
+			return iter -= offset;
+		}
+
+		friend difference_type operator-(const matrix_view_iterator& a, const matrix_view_iterator& b)
+		{
+			return difference_type(a._index) - difference_type(b._index);
+		}
+
+		friend bool operator==(const matrix_view_iterator& a, const matrix_view_iterator& b)
+		{
+			return a._index == b._index;
+		}
+
+		friend bool operator!=(const matrix_view_iterator& a, const matrix_view_iterator& b)
+		{
+			return a._index != b._index;
+		}
+
+		friend bool operator<(const matrix_view_iterator& a, const matrix_view_iterator& b)
+		{
+			return a._index < b._index;
+		}
+
+		friend bool operator>(const matrix_view_iterator& a, const matrix_view_iterator& b)
+		{
+			return a._index > b._index;
+		}
+
+		friend bool operator<=(const matrix_view_iterator& a, const matrix_view_iterator& b)
+		{
+			return a._index <= b._index;
+		}
+
+		friend bool operator>=(const matrix_view_iterator& a, const matrix_view_iterator& b)
+		{
+			return a._index >= b._index;
+		}
+
+	private:
+		number* _base = nullptr;
+		size_t _column_count = 1, _row_stride{}, _column_stride{}, _index{};
+	};
+
+	template <typename number>
+	class matrix_view : public matrix_expression<matrix_view<number>> // Non-owning strided window over matrix storage, number may be const
+	{
+	public:
+		using value_type     = typename std::remove_const<number>::type;
+		using iterator       = matrix_view_iterator<number>;
+		using const_iterator = matrix_view_iterator<const number>;
+
+		matrix_view(number* base, size_t row_count, size_t column_count, size_t row_stride, size_t column_stride = 1) :
+			_base(base), _row_count(row_count), _column_count(column_count), _row_stride(row_stride), _column_stride(column_stride) {}
+
+		operator matrix_view<const number>() const
+		{
+			return matrix_view<const number>(_base, _row_count, _column_count, _row_stride, _column_stride);
+		}
+
+		size_t row_count() const
+		{
+			return _row_count;
+		}
+
+		size_t column_count() const
+		{
+			return _column_count;
+		}
+
+		size_t row_stride() const
+		{
+			return _row_stride;
+		}
+
+		size_t column_stride() const
+		{
+			return _column_stride;
+		}
+
+		number* data() const
+		{
+			return _base;
+		}
+
+		number& data(size_t row_index, size_t column_index) const
+		{
+			if (row_index >= _row_count || column_index >= _column_count)
+				throw subscript_out_of_range();
+			else
+				return _base[row_index * _row_stride + column_index * _column_stride];
+		}
+
+		number& operator()(size_t row_index, size_t column_index) const // Checked only in debug builds
+		{
+#ifndef NDEBUG
+			if (row_index >= _row_count || column_index >= _column_count)
+				throw subscript_out_of_range();
+#endif
+			return _base[row_index * _row_stride + column_index * _column_stride];
+		}
+
+		value_type element(size_t row_index, size_t column_index) const // Unchecked
+		{
+			return _base[row_index * _row_stride + column_index * _column_stride];
+		}
+
+		bool overlaps(const void* begin, const void* end) const // Whether the span from the first to the last element meets [begin, end)
+		{
+			if (_row_count == 0 || _column_count == 0)
+				return false;
+			const number* last = _base + (_row_count - 1) * _row_stride + (_column_count - 1) * _column_stride;
+			return std::less<const void*>()(_base, end) && std::less<const void*>()(begin, last + 1);
+		}
+
+		matrix_view row_view(size_t row_index) const
+		{
+			return block_view(row_index, 0, 1, _column_count);
+		}
+
+		matrix_view column_view(size_t column_index) const
+		{
+			return block_view(0, column_index, _row_count, 1);
+		}
+
+		matrix_view block_view(size_t row_index, size_t column_index, size_t row_count, size_t column_count) const
+		{
+			if (row_count == 0 || column_count == 0)
+				throw matrix_too_small();
+			if (row_index + row_count > _row_count || column_index + column_count > _column_count)
+				throw subscript_out_of_range();
+			return matrix_view(_base + row_index * _row_stride + column_index * _column_stride, row_count, column_count, _row_stride, _column_stride);
+		}
+
+		matrix_view transpose_view() const
+		{
+			return matrix_view(_base, _column_count, _row_count, _column_stride, _row_stride);
+		}
+
+		iterator begin() const
+		{
+			return iterator(_base, _column_count, _row_stride, _column_stride, 0);
+		}
+
+		iterator end() const
+		{
+			return iterator(_base, _column_count, _row_stride, _column_stride, _row_count * _column_count);
+		}
+
+		template <typename derived>
+		const matrix_view& assign(const matrix_expression<derived>& expression) const // Operands must not overlap this view unless they are this view
+		{
+			const derived& expr = expression.self();
+			if (expr.row_count() != _row_count || expr.column_count() != _column_count)
+				throw matrix_unaligned();
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+					_base[row_index * _row_stride + column_index * _column_stride] = expr.element(row_index, column_index);
+			return *this;
+		}
+
+		const matrix_view& fill(const value_type& value) const
+		{
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+					_base[row_index * _row_stride + column_index * _column_stride] = value;
+			return *this;
+		}
+
+	private:
+		number* _base;
+		size_t _row_count, _column_count, _row_stride, _column_stride;
+	};
+
+	template <typename number>
+	struct matrix_operand<matrix_view<number>> // Views are cheap to copy
+	{
+		using type = const matrix_view<number>;
+	};
+
+	template <typename number, typename allocator_type>
+	class matrix : public matrix_expression<matrix<number, allocator_type>>
+	{
+		using row_type         = std::initializer_list<number>;
+		using matrix_type      = std::initializer_list<row_type>;
+		using allocator_traits = std::allocator_traits<allocator_type>;
+
+	public:
+		using value_type = number;
+
+		matrix(size_t row_count, size_t column_count, const matrix_type& nums = {}, const allocator_type& allocator = allocator_type()) :
+			_row_count(row_count), _column_count(column_count), _allocator(allocator)
+		{
+			if (row_count <= 0 || column_count <= 0)
+				throw matrix_too_small();
+			_row_stride = stride_for(_column_count);
+			_data = allocate_elements(_row_count * _row_stride);
+			_capacity = _row_count * _row_stride;
+			if (nums.begin() == nullptr)
+				return;
+			for (size_t row_index = 0; row_index < nums.size() && row_index < _row_count; ++row_index)
+				for (size_t column_index = 0; column_index < nums.begin()[row_index].size() && column_index < _column_count; ++column_index)
+					_data[row_index * _row_stride + column_index] = nums.begin()[row_index].begin()[column_index];
+		}
+
+		matrix(const matrix_type& nums = {}, const allocator_type& allocator = allocator_type()) : _allocator(allocator)
+		{
+			if (nums.begin() == nullptr || nums.size() == 0)
+				throw matrix_too_small();
+			_row_count = nums.size();
+			_column_count = nums.begin()->size();
+			for (size_t row_index = 1; row_index < _row_count; ++row_index)
+				if (nums.begin()[row_index].size() != _column_count)
+					throw matrix_unaligned();
+			_row_stride = stride_for(_column_count);
+			_data = allocate_elements(_row_count * _row_stride);
+			_capacity = _row_count * _row_stride;
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+					_data[row_index * _row_stride + column_index] = nums.begin()[row_index].begin()[column_index];
+		}
+
+		matrix(const matrix& matr) : _allocator(allocator_traits::select_on_container_copy_construction(matr._allocator))
+		{
+			copy_assign(matr);
+		}
+
+		matrix(matrix&& matr) noexcept : _allocator(matr._allocator)
+		{
+			move_assign(std::move(matr));
+		}
+
+		template <typename derived>
+		matrix(const matrix_expression<derived>& expression, const allocator_type& allocator = allocator_type()) :
+			_row_count(expression.self().row_count()), _column_count(expression.self().column_count()), _row_stride(stride_for(_column_count)), _allocator(allocator)
+		{
+			_data = allocate_elements(_row_count * _row_stride);
+			_capacity = _row_count * _row_stride;
+			assign_elements(expression.self());
+		}
+
+		~matrix()
+		{
+			release();
+		}
+
+		size_t row_count() const
+		{
+			return _row_count;
+		}
+
+		size_t column_count() const
+		{
+			return _column_count;
+		}
+
+		size_t row_stride() const // Leading dimension: elements from the start of one row to the next, column_count() unless rows are padded
+		{
+			return _row_stride;
+		}
+
+		size_t capacity() const // Elements the buffer can hold without reallocating
+		{
+			return _capacity;
+		}
+
+		allocator_type get_allocator() const
+		{
+			return _allocator;
+		}
+
+		void reserve(size_t new_capacity)
+		{
+			if (new_capacity <= _capacity)
+				return;
+			number* new_data = allocate_elements(new_capacity);
+			std::move(_data, _data + _row_count * _row_stride, new_data);
+			release();
+			_data = new_data;
+			_capacity = new_capacity;
+		}
+
+		void resize(size_t new_row_count, size_t new_column_count) // Keeps the overlapping top-left block, new elements are zero
+		{
+			if (new_row_count <= 0 || new_column_count <= 0)
+				throw matrix_too_small();
+			const size_t kept_rows = std::min(_row_count, new_row_count), kept_columns = std::min(_column_count, new_column_count);
+			const size_t new_row_stride = stride_for(new_column_count);
+			if (new_row_count * new_row_stride > _capacity)
+			{
+				matrix result(new_row_count, new_column_count, {}, _allocator);
+				for (size_t row_index = 0; row_index < kept_rows; ++row_index)
+					std::move(_data + row_index * _row_stride, _data + row_index * _row_stride + kept_columns, result._data + row_index * new_row_stride);
+				*this = std::move(result);
+				return;
+			}
+			if (new_row_stride <= _row_stride) // Rows only move towards the front, so ascending order never overwrites unread elements
+				for (size_t row_index = 0; row_index < kept_rows; ++row_index)
+					std::move(_data + row_index * _row_stride, _data + row_index * _row_stride + kept_columns, _data + row_index * new_row_stride);
+			else
+				for (size_t row_index = kept_rows; row_index-- > 0;)
+					std::move_backward(_data + row_index * _row_stride, _data + row_index * _row_stride + kept_columns, _data + row_index * new_row_stride + kept_columns);
+			for (size_t row_index = 0; row_index < new_row_count; ++row_index)
+				std::fill(_data + row_index * new_row_stride + (row_index < kept_rows ? kept_columns : 0), _data + row_index * new_row_stride + new_column_count, number{});
+			_row_count = new_row_count;
+			_column_count = new_column_count;
+			_row_stride = new_row_stride;
+		}
+
+		void reshape(size_t new_row_count, size_t new_column_count) // Elements are left unspecified, the buffer is reused when large enough
+		{
+			if (new_row_count <= 0 || new_column_count <= 0)
+				throw matrix_too_small();
+			const size_t new_row_stride = stride_for(new_column_count);
+			if (new_row_count * new_row_stride > _capacity)
+			{
+				number* new_data = allocate_elements(new_row_count * new_row_stride);
+				release();
+				_data = new_data;
+				_capacity = new_row_count * new_row_stride;
+			}
+			_row_count = new_row_count;
+			_column_count = new_column_count;
+			_row_stride = new_row_stride;
+		}
+
+		void assign_product(const matrix& a, const matrix& b) // *this = a * b, through a per-thread scratch buffer when *this is an operand
+		{
+			if (a._column_count != b._row_count)
+				throw matrix_unaligned();
+			const size_t m = a._row_count, n = b._column_count, k = a._column_count;
+			if (this != &a && this != &b)
+			{
+				reshape(m, n);
+				for (size_t row_index = 0; row_index < m; ++row_index)
+					std::fill(_data + row_index * _row_stride, _data + row_index * _row_stride + n, number{});
+				gemm_kernel<number>::multiply(m, n, k, a._data, a._row_stride, b._data, b._row_stride, _data, _row_stride);
+				return;
+			}
+			std::vector<number>& scratch = scratch_buffer();
+			scratch.assign(m * n, number{});
+			gemm_kernel<number>::multiply(m, n, k, a._data, a._row_stride, b._data, b._row_stride, scratch.data(), n);
+			reshape(m, n);
+			for (size_t row_index = 0; row_index < m; ++row_index)
+				std::copy(scratch.begin() + row_index * n, scratch.begin() + (row_index + 1) * n, _data + row_index * _row_stride);
+		}
+
+		number* data()
+		{
+			return _data;
+		}
+
+		const number* data() const
+		{
+			return _data;
+		}
+
+		number& data(size_t row_index, size_t column_index)
+		{
+			if (row_index >= _row_count || column_index >= _column_count)
+				throw subscript_out_of_range();
+			else
+				return _data[row_index * _row_stride + column_index];
+		}
+
+		const number& data(size_t row_index, size_t column_index) const
+		{
+			if (row_index >= _row_count || column_index >= _column_count)
+				throw subscript_out_of_range();
+			else
+				return _data[row_index * _row_stride + column_index];
+		}
+
+		matrix_view<number> view()
+		{
+			return matrix_view<number>(_data, _row_count, _column_count, _row_stride);
+		}
+
+		matrix_view<const number> view() const
+		{
+			return matrix_view<const number>(_data, _row_count, _column_count, _row_stride);
+		}
+
+		matrix_view<number> row_view(size_t row_index)
+		{
+			return view().row_view(row_index);
+		}
+
+		matrix_view<const number> row_view(size_t row_index) const
+		{
+			return view().row_view(row_index);
+		}
+
+		matrix_view<number> column_view(size_t column_index)
+		{
+			return view().column_view(column_index);
+		}
+
+		matrix_view<const number> column_view(size_t column_index) const
+		{
+			return view().column_view(column_index);
+		}
+
+		matrix_view<number> block_view(size_t row_index, size_t column_index, size_t row_count, size_t column_count)
+		{
+			return view().block_view(row_index, column_index, row_count, column_count);
+		}
+
+		matrix_view<const number> block_view(size_t row_index, size_t column_index, size_t row_count, size_t column_count) const
+		{
+			return view().block_view(row_index, column_index, row_count, column_count);
+		}
+
+		matrix_view<number> transpose_view()
+		{
+			return view().transpose_view();
+		}
+
+		matrix_view<const number> transpose_view() const
+		{
+			return view().transpose_view();
+		}
+
+		matrix transpose() const
+		{
+			matrix result(_column_count, _row_count, {}, _allocator);
+			transpose_kernel<number>::transpose(_row_count, _column_count, _data, _row_stride, result._data, result._row_stride);
+			return result;
+		}
+
+		matrix transpose(const parallel_policy& policy) const // Bands of rows are transposed concurrently
+		{
+			matrix result(_column_count, _row_count, {}, _allocator);
+			policy.get_pool().parallel_for(0, _row_count, transpose_kernel<number>::leaf, [this, &result](size_t row_begin, size_t row_end)
+			{
+				transpose_kernel<number>::transpose(row_end - row_begin, _column_count, _data + row_begin * _row_stride, _row_stride, result._data + row_begin, result._row_stride);
+			});
+			return result;
+		}
+
+		matrix& transpose_in_place() // No extra storage for square matrices, others are transposed through a new buffer
+		{
+			if (_row_count == _column_count)
+				transpose_kernel<number>::transpose_in_place(_row_count, _data, _row_stride);
+			else
+				*this = transpose();
+			return *this;
+		}
+
+		matrix minor(size_t row_index, size_t column_index) const
+		{
+			matrix result(_row_count - 1, _column_count - 1, {}, _allocator);
+			size_t new_row_index{}, new_column_index{};
+			for (size_t old_row_index = 0; old_row_index < _row_count; ++old_row_index)
+			{
+				if (old_row_index == row_index)
+					continue;
+				new_column_index = 0;
+				for (size_t old_column_index = 0; old_column_index < _column_count; ++old_column_index)
+				{
+					if (old_column_index == column_index)
+						continue;
+					result.data(new_row_index, new_column_index) = data(old_row_index, old_column_index);
+					++new_column_index;
+				}
+				++new_row_index;
+			}
+			return result;
+		}
+
+		number cofactor(size_t row_index, size_t column_index) const
+		{
+			if (row_index % 2 == column_index % 2)
+				return minor(row_index, column_index).determinant();
+			else
+				return -minor(row_index, column_index).determinant();
+		}
+
+		number determinant() const
+		{
+			return determinant(exact_elimination<number>());
+		}
+
+		lu_decomposition<number> lu() const // Factorize once, then reuse for determinant, inverse and solving
+		{
+			return lu_decomposition<number>(*this);
+		}
+
+		lu_decomposition<number> lu(const parallel_policy& policy) const
+		{
+			return lu_decomposition<number>(*this, policy);
+		}
+
+		cholesky_decomposition<number> cholesky() const // A = LL^T, only for symmetric positive definite floating-point matrices
+		{
+			return cholesky_decomposition<number>(*this);
+		}
+
+		bool symmetric() const
+		{
+			if (_row_count != _column_count)
+				return false;
+			for (size_t row_index = 1; row_index < _row_count; ++row_index)
+				for (size_t column_index = 0; column_index < row_index; ++column_index)
+					if (_data[row_index * _row_stride + column_index] != _data[column_index * _row_stride + row_index])
+						return false;
+			return true;
+		}
+
+		matrix solve(const matrix& b) const // Solve AX = B without forming the inverse, Cholesky when A is symmetric positive definite, LU otherwise
+		{
+			if (_row_count != _column_count || b._row_count != _row_count)
+				throw matrix_unaligned();
+			return solve(b, std::is_floating_point<number>());
+		}
+
+		matrix adjoint() const
+		{
+			matrix result(_row_count, _column_count, {}, _allocator);
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+					result.data(row_index, column_index) = cofactor(row_index, column_index);
+			return result;
+		}
+
+		matrix adjoint_transpose() const
+		{
+			return transpose().adjoint();
+		}
+
+		bool invertible() const
+		{
+			return invertible(exact_elimination<number>());
+		}
+
+		matrix inverse() const
+		{
+			return inverse(exact_elimination<number>());
+		}
+
+		void print(std::ostream& os = std::cout, const char* delimeter1 = " ", const char* delimeter2 = "\n") const
+		{
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+			{
+				if (row_index > 0)
+					os << delimeter2;
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+				{
+					if (column_index > 0)
+						os << delimeter1;
+					os << data(row_index, column_index);
+				}
+			}
+		}
+
+		template <typename element_type, typename element_allocator>
+		friend matrix<element_type, element_allocator> operator*(const matrix<element_type, element_allocator>& a, const matrix<element_type, element_allocator>& b);
+
+		template <typename element_type, typename element_allocator>
+		friend matrix<element_type, element_allocator> operator/(const matrix<element_type, element_allocator>& a, const matrix<element_type, element_allocator>& b);
+
+		matrix& operator=(const matrix& matr)
+		{
+			copy_assign(matr);
+			return *this;
+		}
+
+		matrix& operator=(matrix&& matr) noexcept
+		{
+			move_assign(std::move(matr));
+			return *this;
+		}
+
+		template <typename derived>
+		matrix& operator=(const matrix_expression<derived>& expression) // Written straight into the existing buffer, reshaped when the capacity allows
+		{
+			const derived& expr = expression.self();
+			if (expr.overlaps(_data, _data + _capacity))
+				return *this = matrix(expr, _allocator); // A view may read an element after it is written, and reshaping moves elements the expression still reads
+			if (expr.row_count() != _row_count || expr.column_count() != _column_count)
+				reshape(expr.row_count(), expr.column_count());
+			assign_elements(expr);
+			return *this;
+		}
+
+		template <typename derived>
+		matrix& operator+=(const matrix_expression<derived>& expression)
+		{
+			const derived& expr = expression.self();
+			if (expr.row_count() != _row_count || expr.column_count() != _column_count)
+				throw matrix_unaligned();
+			if (expr.overlaps(_data, _data + _capacity))
+				return *this += matrix(expr, _allocator); // Evaluated first, as a view of *this may read an element after it is updated
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+					_data[row_index * _row_stride + column_index] += expr.element(row_index, column_index);
+			return *this;
+		}
+
+		template <typename derived>
+		matrix& operator-=(const matrix_expression<derived>& expression)
+		{
+			const derived& expr = expression.self();
+			if (expr.row_count() != _row_count || expr.column_count() != _column_count)
+				throw matrix_unaligned();
+			if (expr.overlaps(_data, _data + _capacity))
+				return *this -= matrix(expr, _allocator); // Evaluated first, as a view of *this may read an element after it is updated
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+					_data[row_index * _row_stride + column_index] -= expr.element(row_index, column_index);
+			return *this;
+		}
+
+		matrix& operator*=(const matrix& matr)
+		{
+			assign_product(*this, matr);
+			return *this;
+		}
+
+		matrix& operator*=(const number& scalar)
+		{
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+					_data[row_index * _row_stride + column_index] *= scalar;
+			return *this;
+		}
+
+		matrix& operator/=(const number& scalar)
 		{
-			_row_count = matr._row_count;
-			_column_count = matr._column_count;
 			for (size_t row_index = 0; row_index < _row_count; ++row_index)
 				for (size_t column_index = 0; column_index < _column_count; ++column_index)
-					_data[row_index * _column_count + column_index] = matr._data[row_index * _column_count + column_index];
+					_data[row_index * _row_stride + column_index] /= scalar;
+			return *this;
+		}
+
+		number* operator[](size_t row_index)
+		{
+			return _data + row_index * _row_stride;
+		}
+
+		const number* operator[](size_t row_index) const
+		{
+			return _data + row_index * _row_stride;
+		}
+
+		number& operator()(size_t row_index, size_t column_index)
+		{
+			return data(row_index, column_index);
+		}
+
+		const number& operator()(size_t row_index, size_t column_index) const
+		{
+			return data(row_index, column_index);
+		}
+
+		const number& element(size_t row_index, size_t column_index) const // Unchecked
+		{
+			return _data[row_index * _row_stride + column_index];
+		}
+
+		bool overlaps(const void* begin, const void* end) const
+		{
+			return std::less<const void*>()(_data, end) && std::less<const void*>()(begin, _data + _capacity);
+		}
+
+	private:
+		size_t _row_count{}, _column_count{};
+		size_t _row_stride{};
+		number* _data = nullptr;
+		size_t _capacity{};
+		allocator_type _allocator;
+
+		static size_t stride_for(size_t column_count) // Rows padded to a whole number of matrix_row_alignment blocks when the element size divides it
+		{
+			const size_t alignment = matrix_row_alignment<allocator_type>::value;
+			if (alignment <= sizeof(number) || alignment % sizeof(number) != 0)
+				return column_count;
+			const size_t block = alignment / sizeof(number);
+			return (column_count + block - 1) / block * block;
+		}
+
+		static std::vector<number>& scratch_buffer() // Grows to the largest product seen on this thread, then stops allocating
+		{
+			thread_local std::vector<number> buffer;
+			return buffer;
+		}
+
+		number* allocate_elements(size_t size) // Value-initialized, so arithmetic types start at zero; the caller records the capacity
+		{
+			number* result = allocator_traits::allocate(_allocator, size);
+			size_t constructed = 0;
+			try
+			{
+				for (; constructed < size; ++constructed)
+					allocator_traits::construct(_allocator, result + constructed);
+			}
+			catch (...)
+			{
+				while (constructed > 0)
+					allocator_traits::destroy(_allocator, result + --constructed);
+				allocator_traits::deallocate(_allocator, result, size);
+				throw;
+			}
+			return result;
+		}
+
+		void release() noexcept
+		{
+			if (_data == nullptr)
+				return;
+			for (size_t index = 0; index < _capacity; ++index)
+				allocator_traits::destroy(_allocator, _data + index);
+			allocator_traits::deallocate(_allocator, _data, _capacity);
+			_data = nullptr;
+			_capacity = 0;
+		}
+
+		void copy_assign(const matrix& matr)
+		{
+			if (this == &matr)
+				return;
+			reshape(matr._row_count, matr._column_count);
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+				std::copy(matr._data + row_index * matr._row_stride, matr._data + row_index * matr._row_stride + _column_count, _data + row_index * _row_stride);
+		}
+
+		void move_assign(matrix&& matr) noexcept
+		{
+			std::swap(_row_count, matr._row_count);
+			std::swap(_column_count, matr._column_count);
+			std::swap(_row_stride, matr._row_stride);
+			std::swap(_data, matr._data);
+			std::swap(_capacity, matr._capacity);
+			std::swap(_allocator, matr._allocator);
+		}
+
+		number determinant(std::true_type) const
+		{
+			return bareiss_elimination<number>::determinant(*this);
+		}
+
+		number determinant(std::false_type) const
+		{
+			return lu().determinant();
+		}
+
+		bool invertible(std::true_type) const
+		{
+			return determinant() != number{};
+		}
+
+		bool invertible(std::false_type) const
+		{
+			return !lu().singular();
+		}
+
+		matrix inverse(std::true_type) const
+		{
+			return bareiss_elimination<number>::inverse(*this);
+		}
+
+		matrix inverse(std::false_type) const
+		{
+			return lu().inverse();
+		}
+
+		matrix solve(const matrix& b, std::true_type) const
+		{
+			if (symmetric())
+			{
+				const cholesky_decomposition<number> factor(*this);
+				if (factor.positive_definite())
+					return factor.solve(b);
+			}
+			return lu().solve(b);
+		}
+
+		matrix solve(const matrix& b, std::false_type) const
+		{
+			return lu().solve(b);
+		}
+
+		static matrix divide(const matrix& a, const matrix& b, std::true_type) // Exact types multiply by the Bareiss inverse
+		{
+			return a * b.inverse();
+		}
+
+		static matrix divide(const matrix& a, const matrix& b, std::false_type) // Solved as b^T * x^T = a^T without forming the inverse
+		{
+			return b.transpose().lu().solve(a.transpose()).transpose();
 		}
 
-		void move_assign(matrix&& matr) noexcept
+		template <typename derived>
+		void assign_elements(const derived& expr) // expr must not read the destination
 		{
-			_row_count = matr._row_count;
-			_column_count = matr._column_count;
-			std::swap(_data, matr._data);
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+					_data[row_index * _row_stride + column_index] = expr.element(row_index, column_index);
 		}
 	};
 
-	template <typename number>
-	matrix<number> operator+(const matrix<number>& a, const matrix<number>& b)
+	template <typename lhs_type, typename rhs_type>
+	matrix_binary_expression<lhs_type, rhs_type, std::plus<>> operator+(const matrix_expression<lhs_type>& a, const matrix_expression<rhs_type>& b)
+	{
+		return matrix_binary_expression<lhs_type, rhs_type, std::plus<>>(a.self(), b.self());
+	}
+
+	template <typename lhs_type, typename rhs_type>
+	matrix_binary_expression<lhs_type, rhs_type, std::minus<>> operator-(const matrix_expression<lhs_type>& a, const matrix_expression<rhs_type>& b)
+	{
+		return matrix_binary_expression<lhs_type, rhs_type, std::minus<>>(a.self(), b.self());
+	}
+
+	template <typename expression_type>
+	matrix_negate_expression<expression_type> operator-(const matrix_expression<expression_type>& a)
+	{
+		return matrix_negate_expression<expression_type>(a.self());
+	}
+
+	template <typename expression_type>
+	matrix_scalar_expression<expression_type, std::multiplies<>> operator*(const matrix_expression<expression_type>& a, const typename expression_type::value_type& b)
+	{
+		return matrix_scalar_expression<expression_type, std::multiplies<>>(a.self(), b);
+	}
+
+	template <typename expression_type>
+	matrix_scalar_expression<expression_type, std::multiplies<>> operator*(const typename expression_type::value_type& a, const matrix_expression<expression_type>& b)
+	{
+		return matrix_scalar_expression<expression_type, std::multiplies<>>(b.self(), a);
+	}
+
+	template <typename expression_type>
+	matrix_scalar_expression<expression_type, std::divides<>> operator/(const matrix_expression<expression_type>& a, const typename expression_type::value_type& b)
+	{
+		return matrix_scalar_expression<expression_type, std::divides<>>(a.self(), b);
+	}
+
+	template <typename number, typename allocator_type>
+	matrix<number, allocator_type> operator*(const matrix<number, allocator_type>& a, const matrix<number, allocator_type>& b)
 	{
-		if (a._row_count != b._row_count || a._column_count != b._column_count)
+		if (a._column_count != b._row_count)
 			throw matrix_unaligned();
-		matrix<number> result(a._row_count, a._column_count);
-		for (size_t row_index = 0; row_index < result._row_count; ++row_index)
-			for (size_t column_index = 0; column_index < result._column_count; ++column_index)
-				result.data(row_index, column_index) = a.data(row_index, column_index) + b.data(row_index, column_index);
+		matrix<number, allocator_type> result(a._row_count, b._column_count, {}, a.get_allocator());
+		gemm_kernel<number>::multiply(a._row_count, b._column_count, a._column_count, a._data, a._row_stride, b._data, b._row_stride, result._data, result._row_stride);
 		return result;
 	}
 
-	template <typename number>
-	matrix<number> operator-(const matrix<number>& a, const matrix<number>& b)
+	template <typename lhs_type, typename rhs_type>
+	matrix<typename lhs_type::value_type> operator*(const matrix_expression<lhs_type>& a, const matrix_expression<rhs_type>& b) // Element-wise operands are evaluated before the product
+	{
+		return matrix<typename lhs_type::value_type>(a) * matrix<typename rhs_type::value_type>(b);
+	}
+
+	template <typename number, typename allocator_type>
+	matrix<number, allocator_type> multiply(const matrix<number, allocator_type>& a, const matrix<number, allocator_type>& b)
+	{
+		return a * b;
+	}
+
+	template <typename number, typename allocator_type>
+	matrix<number, allocator_type> multiply(const matrix<number, allocator_type>& a, const matrix<number, allocator_type>& b, const parallel_policy& policy) // Tiles of the result are computed concurrently
 	{
-		if (a._row_count != b._row_count || a._column_count != b._column_count)
+		const size_t tile_rows = 96, tile_columns = 1024;
+		if (a.column_count() != b.row_count())
 			throw matrix_unaligned();
-		matrix<number> result(a._row_count, a._column_count);
-		for (size_t row_index = 0; row_index < result._row_count; ++row_index)
-			for (size_t column_index = 0; column_index < result._column_count; ++column_index)
-				result.data(row_index, column_index) = a.data(row_index, column_index) - b.data(row_index, column_index);
+		const size_t m = a.row_count(), n = b.column_count(), k = a.column_count();
+		const size_t column_tiles = (n + tile_columns - 1) / tile_columns;
+		const size_t tiles = (m + tile_rows - 1) / tile_rows * column_tiles;
+		matrix<number, allocator_type> result(m, n, {}, a.get_allocator());
+		const number* a_data = a.data();
+		const number* b_data = b.data();
+		number* c_data = result.data();
+		const size_t lda = a.row_stride(), ldb = b.row_stride(), ldc = result.row_stride();
+		policy.get_pool().parallel_for(0, tiles, 1, [=](size_t tile_begin, size_t tile_end)
+		{
+			for (size_t tile = tile_begin; tile < tile_end; ++tile)
+			{
+				const size_t row_begin = tile / column_tiles * tile_rows, column_begin = tile % column_tiles * tile_columns;
+				gemm_kernel<number>::multiply(std::min(tile_rows, m - row_begin), std::min(tile_columns, n - column_begin), k,
+					a_data + row_begin * lda, lda, b_data + column_begin, ldb, c_data + row_begin * ldc + column_begin, ldc);
+			}
+		});
 		return result;
 	}
 
-	template <typename number>
-	matrix<number> operator*(const matrix<number>& a, const matrix<number>& b)
+	template <typename number, typename allocator_type>
+	void multiply_into(matrix<number, allocator_type>& dest, const matrix<number, allocator_type>& a, const matrix<number, allocator_type>& b) // dest may be a or b
 	{
-		if (a._column_count != b._row_count)
+		dest.assign_product(a, b);
+	}
+
+	template <typename number, typename allocator_type, typename vector_allocator>
+	void multiply_into(std::vector<number, vector_allocator>& y, const matrix<number, allocator_type>& a, const std::vector<number, vector_allocator>& x) // y = A * x, y must not be x
+	{
+		const size_t m = a.row_count(), n = a.column_count();
+		if (n != x.size())
 			throw matrix_unaligned();
-		matrix<number> result(a._row_count, b._column_count);
-		for (size_t row_index = 0; row_index < result._row_count; ++row_index)
-			for (size_t column_index = 0; column_index < result._column_count; ++column_index)
-				for (size_t mid_index = 0; mid_index < a._column_count; ++mid_index)
-					result.data(row_index, column_index) += a.data(row_index, mid_index) * b.data(mid_index, column_index);
+		y.resize(m);
+		const number* data = a.data();
+		const size_t lda = a.row_stride();
+		for (size_t row_index = 0; row_index < m; ++row_index)
+		{
+			number sum{};
+			for (size_t column_index = 0; column_index < n; ++column_index)
+				sum += data[row_index * lda + column_index] * x[column_index];
+			y[row_index] = sum;
+		}
+	}
+
+	template <typename number, typename allocator_type, typename vector_allocator>
+	std::vector<number, vector_allocator> operator*(const matrix<number, allocator_type>& a, const std::vector<number, vector_allocator>& x)
+	{
+		std::vector<number, vector_allocator> result;
+		multiply_into(result, a, x);
 		return result;
 	}
 
-	template <typename number>
-	matrix<number> operator/(const matrix<number>& a, const matrix<number>& b)
+	template <typename number, typename allocator_type>
+	matrix<number, allocator_type> solve(const matrix<number, allocator_type>& a, const matrix<number, allocator_type>& b)
+	{
+		return a.solve(b);
+	}
+
+	template <typename number, typename allocator_type>
+	void transpose_into(matrix<number, allocator_type>& dest, const matrix<number, allocator_type>& src) // Reuses the buffer of dest, in place when dest is src
+	{
+		if (&dest == &src)
+		{
+			dest.transpose_in_place();
+			return;
+		}
+		dest.reshape(src.column_count(), src.row_count());
+		transpose_kernel<number>::transpose(src.row_count(), src.column_count(), src.data(), src.row_stride(), dest.data(), dest.row_stride());
+	}
+
+	template <typename number, typename allocator_type>
+	void inverse_into(matrix<number, allocator_type>& dest, const matrix<number, allocator_type>& src) // In-place Gauss-Jordan with row pivoting, exact types go through Bareiss
+	{
+		if (src.row_count() != src.column_count())
+			throw matrix_unaligned();
+		if (exact_elimination<number>::value)
+		{
+			dest = src.inverse();
+			return;
+		}
+		const size_t n = src.row_count();
+		thread_local std::vector<size_t> pivot;
+		pivot.resize(n);
+		dest = src;
+		number* data = dest.data();
+		const size_t ld = dest.row_stride();
+		for (size_t step = 0; step < n; ++step)
+		{
+			size_t pivot_row = step;
+			for (size_t row_index = step + 1; row_index < n; ++row_index)
+				if (lu_decomposition<number>::better_pivot(data[row_index * ld + step], data[pivot_row * ld + step], std::is_floating_point<number>()))
+					pivot_row = row_index;
+			if (data[pivot_row * ld + step] == number{})
+				throw matrix_singular();
+			pivot[step] = pivot_row;
+			if (pivot_row != step)
+				std::swap_ranges(data + step * ld, data + step * ld + n, data + pivot_row * ld);
+			number* step_row = data + step * ld;
+			const number scale = number(1) / step_row[step];
+			step_row[step] = 1;
+			for (size_t column_index = 0; column_index < n; ++column_index)
+				step_row[column_index] *= scale;
+			for (size_t row_index = 0; row_index < n; ++row_index)
+			{
+				if (row_index == step)
+					continue;
+				number* row = data + row_index * ld;
+				const number factor = row[step];
+				if (factor == number{})
+					continue;
+				row[step] = number{};
+				for (size_t column_index = 0; column_index < n; ++column_index)
+					row[column_index] -= factor * step_row[column_index];
+			}
+		}
+		for (size_t step = n; step-- > 0;) // Row swaps of A become column swaps of A^-1, undone in reverse
+			if (pivot[step] != step)
+				for (size_t row_index = 0; row_index < n; ++row_index)
+					std::swap(data[row_index * ld + step], data[row_index * ld + pivot[step]]);
+	}
+
+	template <typename number, typename allocator_type>
+	matrix<number, allocator_type> operator/(const matrix<number, allocator_type>& a, const matrix<number, allocator_type>& b) // a * b^-1
 	{
-		return a * b.inverse();
+		if (a._column_count != b._row_count)
+			throw matrix_unaligned();
+		return matrix<number, allocator_type>::divide(a, b, exact_elimination<number>());
 	}
 
 	template <typename number>
-	std::ostream& operator<<(std::ostream& os, const matrix<number>& matr)
+	struct bareiss_scaling // Factor that makes a row integral before fraction-free elimination, integers need none
+	{
+		static number common_denominator(const number*, size_t)
+		{
+			return 1;
+		}
+	};
+
+	template <typename d_type, typename s_type>
+	struct bareiss_scaling<rational<d_type, s_type>> // Least common multiple of the divisors in a row
+	{
+		static rational<d_type, s_type> common_denominator(const rational<d_type, s_type>* row, size_t size)
+		{
+			s_type result = 1;
+			for (size_t index = 0; index < size; ++index)
+			{
+				s_type a = result, b = row[index].divisor();
+				while (b != 0)
+				{
+					const s_type remainder = a % b;
+					a = b;
+					b = remainder;
+				}
+				result = result / a * row[index].divisor();
+			}
+			return rational<d_type, s_type>(d_type(result));
+		}
+	};
+
+	template <typename number>
+	class bareiss_elimination // Fraction-free elimination: every intermediate is a minor of the input, and every division is exact
+	{
+	public:
+		static number determinant(const matrix<number>& matr)
+		{
+			if (matr.row_count() != matr.column_count())
+				throw matrix_unaligned();
+			const size_t n = matr.row_count();
+			matrix<number> work = matr;
+			number* m = work.data();
+			const std::vector<number> scales = scale_rows(m, n, n, n);
+			number previous = 1;
+			bool negative = false;
+			for (size_t step = 0; step + 1 < n; ++step)
+			{
+				if (!select_pivot(m, n, n, step, negative))
+					return number{};
+				const number pivot = m[step * n + step];
+				for (size_t row_index = step + 1; row_index < n; ++row_index)
+				{
+					const number factor = m[row_index * n + step];
+					for (size_t column_index = step + 1; column_index < n; ++column_index)
+						m[row_index * n + column_index] = (pivot * m[row_index * n + column_index] - factor * m[step * n + column_index]) / previous;
+				}
+				previous = pivot;
+			}
+			number result = negative ? -m[n * n - 1] : m[n * n - 1];
+			for (const number& scale : scales)
+				result /= scale;
+			return result;
+		}
+
+		static matrix<number> inverse(const matrix<number>& matr) // Fraction-free Gauss-Jordan on [DA | I], leaving [dI | d * (DA)^-1]
+		{
+			if (matr.row_count() != matr.column_count())
+				throw matrix_unaligned();
+			const size_t n = matr.row_count(), width = 2 * n;
+			matrix<number> work(n, width);
+			number* m = work.data();
+			for (size_t row_index = 0; row_index < n; ++row_index)
+			{
+				std::copy(matr.data() + row_index * n, matr.data() + row_index * n + n, m + row_index * width);
+				m[row_index * width + n + row_index] = 1;
+			}
+			const std::vector<number> scales = scale_rows(m, n, n, width);
+			number previous = 1;
+			bool negative = false;
+			for (size_t step = 0; step < n; ++step)
+			{
+				if (!select_pivot(m, n, width, step, negative))
+					throw matrix_singular();
+				const number pivot = m[step * width + step];
+				for (size_t row_index = 0; row_index < n; ++row_index)
+				{
+					if (row_index == step)
+						continue;
+					const number factor = m[row_index * width + step];
+					for (size_t column_index = 0; column_index < width; ++column_index)
+						if (column_index != step)
+							m[row_index * width + column_index] = (pivot * m[row_index * width + column_index] - factor * m[step * width + column_index]) / previous;
+					m[row_index * width + step] = number{};
+				}
+				previous = pivot;
+			}
+			matrix<number> result(n, n);
+			for (size_t row_index = 0; row_index < n; ++row_index)
+				for (size_t column_index = 0; column_index < n; ++column_index)
+				{
+					number& element = result.data()[row_index * n + column_index];
+					element = m[row_index * width + n + column_index] / previous;
+					if (!scales.empty())
+						element *= scales[column_index]; // A^-1 = (DA)^-1 * D
+				}
+			return result;
+		}
+
+	private:
+		static std::vector<number> scale_rows(number* m, size_t n, size_t columns, size_t width) // Returns the row factors, or nothing if all are one
+		{
+			std::vector<number> scales(n, number(1));
+			bool scaled = false;
+			for (size_t row_index = 0; row_index < n; ++row_index)
+			{
+				scales[row_index] = bareiss_scaling<number>::common_denominator(m + row_index * width, columns);
+				if (scales[row_index] == number(1))
+					continue;
+				scaled = true;
+				for (size_t column_index = 0; column_index < columns; ++column_index)
+					m[row_index * width + column_index] *= scales[row_index];
+			}
+			if (!scaled)
+				scales.clear();
+			return scales;
+		}
+
+		static bool select_pivot(number* m, size_t n, size_t width, size_t step, bool& negative) // First non-zero at or below the diagonal
+		{
+			size_t pivot_row = step;
+			while (pivot_row < n && m[pivot_row * width + step] == number{})
+				++pivot_row;
+			if (pivot_row == n)
+				return false;
+			if (pivot_row != step)
+			{
+				std::swap_ranges(m + step * width, m + step * width + width, m + pivot_row * width);
+				negative = !negative;
+			}
+			return true;
+		}
+	};
+
+	template <typename number>
+	class lu_decomposition // PA = LU with partial pivoting, L has a unit diagonal and shares storage with U
+	{
+	public:
+		lu_decomposition(const matrix<number>& matr) : _lu(matr), _pivot(matr.row_count())
+		{
+			if (matr.row_count() != matr.column_count())
+				throw matrix_unaligned();
+			factorize(nullptr);
+		}
+
+		lu_decomposition(const matrix<number>& matr, const parallel_policy& policy) : _lu(matr), _pivot(matr.row_count())
+		{
+			if (matr.row_count() != matr.column_count())
+				throw matrix_unaligned();
+			factorize(&policy.get_pool());
+		}
+
+		size_t size() const
+		{
+			return _pivot.size();
+		}
+
+		bool singular() const
+		{
+			return _singular;
+		}
+
+		const matrix<number>& packed() const // Strict lower part is L, upper part with diagonal is U
+		{
+			return _lu;
+		}
+
+		const std::vector<size_t>& pivot() const // Row pivot[i] of the original matrix is row i of PA
+		{
+			return _pivot;
+		}
+
+		number determinant() const
+		{
+			if (_singular)
+				return number{};
+			const size_t n = size();
+			const number* lu = _lu.data();
+			number result = lu[0];
+			for (size_t index = 1; index < n; ++index)
+				result *= lu[index * n + index];
+			if (_odd_swaps)
+				result = -result;
+			return result;
+		}
+
+		matrix<number> solve(const matrix<number>& b) const // Solve AX = B, one column of X per column of B
+		{
+			matrix<number> result = permuted(b);
+			substitute(result, 0, result.column_count());
+			return result;
+		}
+
+		matrix<number> solve(const matrix<number>& b, const parallel_policy& policy) const // Columns of B are solved concurrently
+		{
+			matrix<number> result = permuted(b);
+			policy.get_pool().parallel_for(0, result.column_count(), parallel_grain, [&](size_t column_begin, size_t column_end)
+			{
+				substitute(result, column_begin, column_end);
+			});
+			return result;
+		}
+
+		matrix<number> inverse() const
+		{
+			return solve(identity());
+		}
+
+		matrix<number> inverse(const parallel_policy& policy) const
+		{
+			return solve(identity(), policy);
+		}
+
+		// Floating-point types pivot on the largest magnitude for stability, exact types only need a non-zero pivot
+		static bool better_pivot(const number& candidate, const number& current, std::true_type)
+		{
+			return std::abs(candidate) > std::abs(current);
+		}
+
+		static bool better_pivot(const number& candidate, const number& current, std::false_type)
+		{
+			return current == number{} && candidate != number{};
+		}
+
+	private:
+		matrix<number> _lu;
+		std::vector<size_t> _pivot;
+		bool _odd_swaps = false;
+		bool _singular = false;
+
+		static constexpr size_t parallel_grain = 32; // Rows or columns per task, smaller slices are not worth a task
+
+		matrix<number> identity() const
+		{
+			const size_t n = size();
+			matrix<number> result(n, n);
+			for (size_t index = 0; index < n; ++index)
+				result.data()[index * n + index] = 1;
+			return result;
+		}
+
+		matrix<number> permuted(const matrix<number>& b) const // Rows of B in pivot order, ready for substitution
+		{
+			const size_t n = size(), m = b.column_count();
+			if (b.row_count() != n)
+				throw matrix_unaligned();
+			if (_singular)
+				throw matrix_singular();
+			matrix<number> result(n, m);
+			const number* src = b.data();
+			number* x = result.data();
+			for (size_t row_index = 0; row_index < n; ++row_index)
+				std::copy(src + _pivot[row_index] * m, src + _pivot[row_index] * m + m, x + row_index * m);
+			return result;
+		}
+
+		void substitute(matrix<number>& result, size_t column_begin, size_t column_end) const // Forward with L, then backward with U
+		{
+			const size_t n = size(), m = result.column_count();
+			const number* lu = _lu.data();
+			number* x = result.data();
+			for (size_t row_index = 1; row_index < n; ++row_index)
+				for (size_t mid_index = 0; mid_index < row_index; ++mid_index)
+				{
+					const number factor = lu[row_index * n + mid_index];
+					if (factor == number{})
+						continue;
+					for (size_t column_index = column_begin; column_index < column_end; ++column_index)
+						x[row_index * m + column_index] -= factor * x[mid_index * m + column_index];
+				}
+			for (size_t row_index = n; row_index-- > 0;)
+			{
+				for (size_t mid_index = row_index + 1; mid_index < n; ++mid_index)
+				{
+					const number factor = lu[row_index * n + mid_index];
+					if (factor == number{})
+						continue;
+					for (size_t column_index = column_begin; column_index < column_end; ++column_index)
+						x[row_index * m + column_index] -= factor * x[mid_index * m + column_index];
+				}
+				const number diagonal = lu[row_index * n + row_index];
+				for (size_t column_index = column_begin; column_index < column_end; ++column_index)
+					x[row_index * m + column_index] /= diagonal;
+			}
+		}
+
+		void factorize(thread_pool* pool) // Rows below the pivot are updated concurrently when a pool is given
+		{
+			const size_t n = size();
+			number* lu = _lu.data();
+			for (size_t index = 0; index < n; ++index)
+				_pivot[index] = index;
+			for (size_t step = 0; step < n; ++step)
+			{
+				size_t pivot_row = step;
+				for (size_t row_index = step + 1; row_index < n; ++row_index)
+					if (better_pivot(lu[row_index * n + step], lu[pivot_row * n + step], std::is_floating_point<number>()))
+						pivot_row = row_index;
+				if (lu[pivot_row * n + step] == number{})
+				{
+					_singular = true;
+					continue;
+				}
+				if (pivot_row != step)
+				{
+					std::swap_ranges(lu + step * n, lu + step * n + n, lu + pivot_row * n);
+					std::swap(_pivot[step], _pivot[pivot_row]);
+					_odd_swaps = !_odd_swaps;
+				}
+				const number diagonal = lu[step * n + step];
+				const auto eliminate = [lu, n, step, &diagonal](size_t row_begin, size_t row_end)
+				{
+					for (size_t row_index = row_begin; row_index < row_end; ++row_index)
+					{
+						number& factor = lu[row_index * n + step];
+						if (factor == number{})
+							continue;
+						factor /= diagonal;
+						for (size_t column_index = step + 1; column_index < n; ++column_index)
+							lu[row_index * n + column_index] -= factor * lu[step * n + column_index];
+					}
+				};
+				if (pool && (n - step) * (n - step) >= parallel_grain * parallel_grain * 4)
+					pool->parallel_for(step + 1, n, parallel_grain, eliminate);
+				else
+					eliminate(step + 1, n);
+			}
+		}
+	};
+
+	template <typename number>
+	class cholesky_decomposition // A = LL^T for symmetric positive definite A, half the work of LU and no pivoting
+	{
+	public:
+		cholesky_decomposition(const matrix<number>& matr) : _l(matr)
+		{
+			if (matr.row_count() != matr.column_count())
+				throw matrix_unaligned();
+			factorize();
+		}
+
+		size_t size() const
+		{
+			return _l.row_count();
+		}
+
+		bool positive_definite() const
+		{
+			return _positive_definite;
+		}
+
+		const matrix<number>& packed() const // L, with the strict upper part zero
+		{
+			return _l;
+		}
+
+		number determinant() const
+		{
+			if (!_positive_definite)
+				throw matrix_not_positive_definite();
+			const size_t n = size();
+			const number* l = _l.data();
+			number result = 1;
+			for (size_t index = 0; index < n; ++index)
+				result *= l[index * n + index] * l[index * n + index];
+			return result;
+		}
+
+		matrix<number> solve(const matrix<number>& b) const // Forward with L, then backward with L^T
+		{
+			const size_t n = size(), m = b.column_count();
+			if (b.row_count() != n)
+				throw matrix_unaligned();
+			if (!_positive_definite)
+				throw matrix_not_positive_definite();
+			matrix<number> result = b;
+			const number* l = _l.data();
+			number* x = result.data();
+			for (size_t row_index = 0; row_index < n; ++row_index)
+			{
+				for (size_t mid_index = 0; mid_index < row_index; ++mid_index)
+				{
+					const number factor = l[row_index * n + mid_index];
+					for (size_t column_index = 0; column_index < m; ++column_index)
+						x[row_index * m + column_index] -= factor * x[mid_index * m + column_index];
+				}
+				for (size_t column_index = 0; column_index < m; ++column_index)
+					x[row_index * m + column_index] /= l[row_index * n + row_index];
+			}
+			for (size_t row_index = n; row_index-- > 0;)
+			{
+				for (size_t column_index = 0; column_index < m; ++column_index)
+					x[row_index * m + column_index] /= l[row_index * n + row_index];
+				for (size_t mid_index = 0; mid_index < row_index; ++mid_index) // Column row_index of L^T is row row_index of L
+				{
+					const number factor = l[row_index * n + mid_index];
+					for (size_t column_index = 0; column_index < m; ++column_index)
+						x[mid_index * m + column_index] -= factor * x[row_index * m + column_index];
+				}
+			}
+			return result;
+		}
+
+		matrix<number> inverse() const
+		{
+			const size_t n = size();
+			matrix<number> identity(n, n);
+			for (size_t index = 0; index < n; ++index)
+				identity.data()[index * n + index] = 1;
+			return solve(identity);
+		}
+
+	private:
+		matrix<number> _l;
+		bool _positive_definite = true;
+
+		void factorize() // Row by row, each entry is a dot product of two contiguous row prefixes of L
+		{
+			const size_t n = size();
+			number* l = _l.data();
+			for (size_t row_index = 0; row_index < n; ++row_index)
+			{
+				number* row = l + row_index * n;
+				for (size_t column_index = 0; column_index <= row_index; ++column_index)
+				{
+					const number* other = l + column_index * n;
+					number sum = row[column_index];
+					for (size_t mid_index = 0; mid_index < column_index; ++mid_index)
+						sum -= row[mid_index] * other[mid_index];
+					if (column_index < row_index)
+						row[column_index] = sum / other[column_index];
+					else if (sum > number{})
+						row[column_index] = std::sqrt(sum);
+					else
+					{
+						_positive_definite = false;
+						return;
+					}
+				}
+				std::fill(row + row_index + 1, row + n, number{});
+			}
+		}
+	};
+
+	template <typename number, typename allocator_type>
+	std::ostream& operator<<(std::ostream& os, const matrix<number, allocator_type>& matr)
 	{
 		matr.print(os);
 		return os;
 	}
+
+	template <typename derived>
+	std::ostream& operator<<(std::ostream& os, const matrix_expression<derived>& expression)
+	{
+		matrix<typename derived::value_type>(expression).print(os);
+		return os;
+	}
 }
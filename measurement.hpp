@@ -6,7 +6,7 @@ namespace zaoly
 	class measurement // Levels of measurement
 	{
 	public:
-		measurement(number num = {}) : data(num) {}
+		constexpr measurement(number num = {}) : data(num) {}
 
 		virtual number raw() const
 		{
@@ -37,10 +37,10 @@ class_name& operator=(const number& num)     \
 		ASSIGNMENT_OPERATOR(nominal)
 
 		template <typename number>
-		friend bool operator==(const nominal<number>& a, const nominal<number>& b);
+		friend constexpr bool operator==(const nominal<number>& a, const nominal<number>& b);
 
 		template <typename number>
-		friend bool operator!=(const nominal<number>& a, const nominal<number>& b);
+		friend constexpr bool operator!=(const nominal<number>& a, const nominal<number>& b);
 
 	protected:
 		using measurement<number>::measurement;
@@ -48,13 +48,13 @@ class_name& operator=(const number& num)     \
 	};
 
 	template <typename number>
-	bool operator==(const nominal<number>& a, const nominal<number>& b)
+	constexpr bool operator==(const nominal<number>& a, const nominal<number>& b)
 	{
 		return a.data == b.data;
 	}
 
 	template <typename number>
-	bool operator!=(const nominal<number>& a, const nominal<number>& b)
+	constexpr bool operator!=(const nominal<number>& a, const nominal<number>& b)
 	{
 		return a.data != b.data;
 	}
@@ -66,16 +66,16 @@ class_name& operator=(const number& num)     \
 		ASSIGNMENT_OPERATOR(ordinal)
 
 		template <typename number>
-		friend bool operator<(const ordinal<number>& a, const ordinal<number>& b);
+		friend constexpr bool operator<(const ordinal<number>& a, const ordinal<number>& b);
 
 		template <typename number>
-		friend bool operator>(const ordinal<number>& a, const ordinal<number>& b);
+		friend constexpr bool operator>(const ordinal<number>& a, const ordinal<number>& b);
 
 		template <typename number>
-		friend bool operator<=(const ordinal<number>& a, const ordinal<number>& b);
+		friend constexpr bool operator<=(const ordinal<number>& a, const ordinal<number>& b);
 
 		template <typename number>
-		friend bool operator>=(const ordinal<number>& a, const ordinal<number>& b);
+		friend constexpr bool operator>=(const ordinal<number>& a, const ordinal<number>& b);
 
 	protected:
 		using nominal<number>::nominal;
@@ -83,25 +83,25 @@ class_name& operator=(const number& num)     \
 	};
 
 	template <typename number>
-	bool operator<(const ordinal<number>& a, const ordinal<number>& b)
+	constexpr bool operator<(const ordinal<number>& a, const ordinal<number>& b)
 	{
 		return a.data < b.data;
 	}
 
 	template <typename number>
-	bool operator>(const ordinal<number>& a, const ordinal<number>& b)
+	constexpr bool operator>(const ordinal<number>& a, const ordinal<number>& b)
 	{
 		return a.data > b.data;
 	}
 
 	template <typename number>
-	bool operator<=(const ordinal<number>& a, const ordinal<number>& b)
+	constexpr bool operator<=(const ordinal<number>& a, const ordinal<number>& b)
 	{
 		return a.data <= b.data;
 	}
 
 	template <typename number>
-	bool operator>=(const ordinal<number>& a, const ordinal<number>& b)
+	constexpr bool operator>=(const ordinal<number>& a, const ordinal<number>& b)
 	{
 		return a.data >= b.data;
 	}
@@ -109,6 +109,9 @@ class_name& operator=(const number& num)     \
 	template <typename number, size_t _unit>
 	class ratio;
 
+	template <long long _dividend, unsigned long long _divisor>
+	struct static_rational; // static-rational.hpp
+
 	template <typename number, size_t _unit = 1>
 	class interval : public ordinal<number> // Interval data, only distinguishes locations, where only the interval between two data makes sense
 	{
@@ -118,19 +121,19 @@ class_name& operator=(const number& num)     \
 		ASSIGNMENT_OPERATOR(interval)
 
 		template <typename number, size_t _unit>
-		friend interval<number, _unit> operator+(const interval<number, _unit>& a, const ratio<number, _unit>& b);
+		friend constexpr interval<number, _unit> operator+(const interval<number, _unit>& a, const ratio<number, _unit>& b);
 
 		template <typename number, size_t _unit>
-		friend interval<number, _unit> operator+(const ratio<number, _unit>& a, const interval<number, _unit>& b);
+		friend constexpr interval<number, _unit> operator+(const ratio<number, _unit>& a, const interval<number, _unit>& b);
 
 		template <typename number, size_t _unit>
-		friend interval<number, _unit> operator-(const interval<number, _unit>& a, const ratio<number, _unit>& b);
+		friend constexpr interval<number, _unit> operator-(const interval<number, _unit>& a, const ratio<number, _unit>& b);
 
 		template <typename number, size_t _unit>
-		friend interval<number, _unit> operator-(const ratio<number, _unit>& a, const interval<number, _unit>& b);
+		friend constexpr interval<number, _unit> operator-(const ratio<number, _unit>& a, const interval<number, _unit>& b);
 
 		template <typename number, size_t _unit>
-		friend ratio<number, _unit> operator-(const interval<number, _unit>& a, const interval<number, _unit>& b);
+		friend constexpr ratio<number, _unit> operator-(const interval<number, _unit>& a, const interval<number, _unit>& b);
 
 		interval operator+()
 		{
@@ -196,19 +199,19 @@ class_name& operator=(const number& num)     \
 		// With interval data:
 
 		template <typename number, size_t _unit>
-		friend interval<number, _unit> operator+(const interval<number, _unit>& a, const ratio<number, _unit>& b);
+		friend constexpr interval<number, _unit> operator+(const interval<number, _unit>& a, const ratio<number, _unit>& b);
 
 		template <typename number, size_t _unit>
-		friend interval<number, _unit> operator+(const ratio<number, _unit>& a, const interval<number, _unit>& b);
+		friend constexpr interval<number, _unit> operator+(const ratio<number, _unit>& a, const interval<number, _unit>& b);
 
 		template <typename number, size_t _unit>
-		friend interval<number, _unit> operator-(const interval<number, _unit>& a, const ratio<number, _unit>& b);
+		friend constexpr interval<number, _unit> operator-(const interval<number, _unit>& a, const ratio<number, _unit>& b);
 
 		template <typename number, size_t _unit>
-		friend interval<number, _unit> operator-(const ratio<number, _unit>& a, const interval<number, _unit>& b);
+		friend constexpr interval<number, _unit> operator-(const ratio<number, _unit>& a, const interval<number, _unit>& b);
 
 		template <typename number, size_t _unit>
-		friend ratio<number, _unit> operator-(const interval<number, _unit>& a, const interval<number, _unit>& b);
+		friend constexpr ratio<number, _unit> operator-(const interval<number, _unit>& a, const interval<number, _unit>& b);
 
 		template <typename number, size_t _unit>
 		friend interval<number, _unit>& interval<number, _unit>::operator+=(const ratio<number, _unit>& num);
@@ -219,19 +222,30 @@ class_name& operator=(const number& num)     \
 		// Without interval data:
 
 		template <typename number, size_t _unit>
-		friend ratio<number, _unit> operator+(const ratio<number, _unit>& a, const ratio<number, _unit>& b);
+		friend constexpr ratio<number, _unit> operator+(const ratio<number, _unit>& a, const ratio<number, _unit>& b);
 
 		template <typename number, size_t _unit>
-		friend ratio<number, _unit> operator-(const ratio<number, _unit>& a, const ratio<number, _unit>& b);
+		friend constexpr ratio<number, _unit> operator-(const ratio<number, _unit>& a, const ratio<number, _unit>& b);
 
 		template <typename number, size_t _unit_1, size_t _unit_2>
-		friend ratio<number, _unit_1 * _unit_2> operator*(const ratio<number, _unit_1>& a, const ratio<number, _unit_2>& b);
+		friend constexpr ratio<number, _unit_1 * _unit_2> operator*(const ratio<number, _unit_1>& a, const ratio<number, _unit_2>& b);
 
 		template <typename number, size_t _unit_1, size_t _unit_2>
-		friend ratio<number, _unit_1 / _unit_2> operator/(const ratio<number, _unit_1>& a, const ratio<number, _unit_2>& b);
+		friend constexpr ratio<number, _unit_1 / _unit_2> operator/(const ratio<number, _unit_1>& a, const ratio<number, _unit_2>& b);
 
 		template <typename number, size_t _unit_1, size_t _unit_2>
-		friend ratio<number, _unit_1> operator%(const ratio<number, _unit_1>& a, const ratio<number, _unit_2>& b);
+		friend constexpr ratio<number, _unit_1> operator%(const ratio<number, _unit_1>& a, const ratio<number, _unit_2>& b);
+
+		// With compile-time factors:
+
+		template <typename number, size_t _unit, long long _dividend, unsigned long long _divisor>
+		friend constexpr ratio<number, _unit> operator*(const ratio<number, _unit>& a, static_rational<_dividend, _divisor> b);
+
+		template <typename number, size_t _unit, long long _dividend, unsigned long long _divisor>
+		friend constexpr ratio<number, _unit> operator*(static_rational<_dividend, _divisor> a, const ratio<number, _unit>& b);
+
+		template <typename number, size_t _unit, long long _dividend, unsigned long long _divisor>
+		friend constexpr ratio<number, _unit> operator/(const ratio<number, _unit>& a, static_rational<_dividend, _divisor> b);
 
 		ratio& operator*=(const ratio& num)
 		{
@@ -285,31 +299,31 @@ class_name& operator=(const number& num)     \
 	// Operators with interval data, maybe also ratio data:
 
 	template <typename number, size_t _unit>
-	interval<number, _unit> operator+(const interval<number, _unit>& a, const ratio<number, _unit>& b)
+	constexpr interval<number, _unit> operator+(const interval<number, _unit>& a, const ratio<number, _unit>& b)
 	{
 		return interval<number, _unit>(a.data + b.data);
 	}
 
 	template <typename number, size_t _unit>
-	interval<number, _unit> operator+(const ratio<number, _unit>& a, const interval<number, _unit>& b)
+	constexpr interval<number, _unit> operator+(const ratio<number, _unit>& a, const interval<number, _unit>& b)
 	{
 		return interval<number, _unit>(a.data + b.data);
 	}
 
 	template <typename number, size_t _unit>
-	interval<number, _unit> operator-(const interval<number, _unit>& a, const ratio<number, _unit>& b)
+	constexpr interval<number, _unit> operator-(const interval<number, _unit>& a, const ratio<number, _unit>& b)
 	{
 		return interval<number, _unit>(a.data - b.data);
 	}
 
 	template <typename number, size_t _unit>
-	interval<number, _unit> operator-(const ratio<number, _unit>& a, const interval<number, _unit>& b)
+	constexpr interval<number, _unit> operator-(const ratio<number, _unit>& a, const interval<number, _unit>& b)
 	{
 		return interval<number, _unit>(a.data - b.data);
 	}
 
 	template <typename number, size_t _unit>
-	ratio<number, _unit> operator-(const interval<number, _unit>& a, const interval<number, _unit>& b)
+	constexpr ratio<number, _unit> operator-(const interval<number, _unit>& a, const interval<number, _unit>& b)
 	{
 		return ratio<number, _unit>(a.data - b.data);
 	}
@@ -317,33 +331,53 @@ class_name& operator=(const number& num)     \
 	// Functions with only ratio data:
 
 	template <typename number, size_t _unit>
-	ratio<number, _unit> operator+(const ratio<number, _unit>& a, const ratio<number, _unit>& b)
+	constexpr ratio<number, _unit> operator+(const ratio<number, _unit>& a, const ratio<number, _unit>& b)
 	{
 		return ratio<number, _unit>(a.data + b.data);
 	}
 
 	template <typename number, size_t _unit>
-	ratio<number, _unit> operator-(const ratio<number, _unit>& a, const ratio<number, _unit>& b)
+	constexpr ratio<number, _unit> operator-(const ratio<number, _unit>& a, const ratio<number, _unit>& b)
 	{
 		return ratio<number, _unit>(a.data - b.data);
 	}
 
 	template <typename number, size_t _unit_1, size_t _unit_2>
-	ratio<number, _unit_1 * _unit_2> operator*(const ratio<number, _unit_1>& a, const ratio<number, _unit_2>& b)
+	constexpr ratio<number, _unit_1 * _unit_2> operator*(const ratio<number, _unit_1>& a, const ratio<number, _unit_2>& b)
 	{
 		return ratio<number, _unit_1 * _unit_2>(a.data * b.data);
 	}
 
 	template <typename number, size_t _unit_1, size_t _unit_2>
-	ratio<number, _unit_1 / _unit_2> operator/(const ratio<number, _unit_1>& a, const ratio<number, _unit_2>& b)
+	constexpr ratio<number, _unit_1 / _unit_2> operator/(const ratio<number, _unit_1>& a, const ratio<number, _unit_2>& b)
 	{
 		static_assert(_unit_2 > 0 && _unit_1 % _unit_2 == 0, "Unit 1 is indivisible by Unit 2");
 		return ratio<number, _unit_1 / _unit_2>(a.data / b.data);
 	}
 
 	template <typename number, size_t _unit_1, size_t _unit_2>
-	ratio<number, _unit_1> operator%(const ratio<number, _unit_1>& a, const ratio<number, _unit_2>& b)
+	constexpr ratio<number, _unit_1> operator%(const ratio<number, _unit_1>& a, const ratio<number, _unit_2>& b)
 	{
 		return ratio<number, _unit_1>(a.data % b.data);
 	}
+
+	// Functions with ratio data and compile-time factors, which keep the unit:
+
+	template <typename number, size_t _unit, long long _dividend, unsigned long long _divisor>
+	constexpr ratio<number, _unit> operator*(const ratio<number, _unit>& a, static_rational<_dividend, _divisor> b)
+	{
+		return ratio<number, _unit>(a.data * number(b.dividend) / number(b.divisor));
+	}
+
+	template <typename number, size_t _unit, long long _dividend, unsigned long long _divisor>
+	constexpr ratio<number, _unit> operator*(static_rational<_dividend, _divisor> a, const ratio<number, _unit>& b)
+	{
+		return ratio<number, _unit>(number(a.dividend) * b.data / number(a.divisor));
+	}
+
+	template <typename number, size_t _unit, long long _dividend, unsigned long long _divisor>
+	constexpr ratio<number, _unit> operator/(const ratio<number, _unit>& a, static_rational<_dividend, _divisor> b) // b != 0
+	{
+		return ratio<number, _unit>(a.data * number(b.divisor) / number(b.dividend));
+	}
 }
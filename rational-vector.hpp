@@ -0,0 +1,394 @@
+#pragma once
+
+#include "batch-matrix.hpp"
+#include "rational.hpp"
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace zaoly
+{
+	template <typename d_type, typename s_type>
+	struct rational_vector_kernel // Elementwise loops over whole blocks of lanes; results are left unreduced until some lane reaches half the integer width
+	{
+		static_assert(std::is_integral<d_type>::value && std::is_integral<s_type>::value, "rational_vector needs built-in integers");
+
+		using value_type = rational<d_type, s_type>;
+
+		static constexpr size_t lanes = batch_lanes<d_type>::value;
+		static constexpr s_type reduce_limit = s_type(1) << (std::numeric_limits<d_type>::digits / 2); // Magnitudes below it keep every product of two operands within d_type
+
+		static s_type magnitude(d_type d) // Branch-free: the signs in a column are as good as random
+		{
+			const s_type sign = s_type(0) - s_type(d < 0);
+			return (s_type(d) ^ sign) - sign;
+		}
+
+		static void add_blocks(size_t count, const d_type* a_dividends, const s_type* a_divisors, const d_type* b_dividends, const s_type* b_divisors, d_type* dividends, s_type* divisors, bool subtract)
+		{
+			const auto op = [subtract](value_type a, const value_type& b) { return subtract ? a -= b : a += b; };
+			for (size_t block = 0; block < count; block += lanes)
+			{
+				const exact_lanes<decltype(op)> exact(block, a_dividends, a_divisors, b_dividends, b_divisors, op);
+				ZAOLY_BATCH_LANES_LOOP
+				for (size_t lane = block; lane < block + lanes; ++lane) // Equal divisors, common in columns of prices or counts, add without growing
+				{
+					const bool same = a_divisors[lane] == b_divisors[lane];
+					const s_type left = s_type(a_dividends[lane]) * (same ? s_type(1) : b_divisors[lane]);
+					const s_type right = s_type(b_dividends[lane]) * (same ? s_type(1) : a_divisors[lane]);
+					dividends[lane] = d_type(subtract ? left - right : left + right);
+					divisors[lane] = same ? a_divisors[lane] : a_divisors[lane] * b_divisors[lane];
+				}
+				exact.store(dividends + block, divisors + block);
+				reduce_if_large(dividends + block, divisors + block);
+			}
+		}
+
+		static void multiply_blocks(size_t count, const d_type* a_dividends, const s_type* a_divisors, const d_type* b_dividends, const s_type* b_divisors, d_type* dividends, s_type* divisors)
+		{
+			const auto op = [](value_type a, const value_type& b) { return a *= b; };
+			for (size_t block = 0; block < count; block += lanes)
+			{
+				const exact_lanes<decltype(op)> exact(block, a_dividends, a_divisors, b_dividends, b_divisors, op);
+				ZAOLY_BATCH_LANES_LOOP
+				for (size_t lane = block; lane < block + lanes; ++lane)
+				{
+					dividends[lane] = d_type(s_type(a_dividends[lane]) * s_type(b_dividends[lane]));
+					divisors[lane] = a_divisors[lane] * b_divisors[lane];
+				}
+				exact.store(dividends + block, divisors + block);
+				reduce_if_large(dividends + block, divisors + block);
+			}
+		}
+
+		static void divide_blocks(size_t count, const d_type* a_dividends, const s_type* a_divisors, const d_type* b_dividends, const s_type* b_divisors, d_type* dividends, s_type* divisors) // Every b nonzero; a zero dividend, as in the padding, is read as one
+		{
+			const auto op = [](value_type a, const value_type& b) { return b.dividend() == 0 ? a : a /= b; };
+			for (size_t block = 0; block < count; block += lanes)
+			{
+				const exact_lanes<decltype(op)> exact(block, a_dividends, a_divisors, b_dividends, b_divisors, op);
+				ZAOLY_BATCH_LANES_LOOP
+				for (size_t lane = block; lane < block + lanes; ++lane) // The sign of b moves to the dividend
+				{
+					const s_type dividend = s_type(a_dividends[lane]) * b_divisors[lane];
+					dividends[lane] = d_type(b_dividends[lane] < 0 ? s_type(0) - dividend : dividend);
+					divisors[lane] = a_divisors[lane] * (b_dividends[lane] == 0 ? s_type(1) : magnitude(b_dividends[lane]));
+				}
+				exact.store(dividends + block, divisors + block);
+				reduce_if_large(dividends + block, divisors + block);
+			}
+		}
+
+		static void compare_blocks(size_t count, const d_type* a_dividends, const s_type* a_divisors, const d_type* b_dividends, const s_type* b_divisors, int* results) // Cross products like rational's comparisons
+		{
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t index = 0; index < count; ++index)
+			{
+				const d_type left = a_dividends[index] * d_type(b_divisors[index]), right = b_dividends[index] * d_type(a_divisors[index]);
+				results[index] = int(left > right) - int(left < right);
+			}
+		}
+
+		template <typename operation>
+		class exact_lanes // Lanes of one block with an operand past reduce_limit, whose plain products may overflow, computed by rational's cross-cancelling arithmetic before the results overwrite an aliased operand
+		{
+		public:
+			exact_lanes(size_t block, const d_type* a_dividends, const s_type* a_divisors, const d_type* b_dividends, const s_type* b_divisors, operation op)
+			{
+				s_type bits = 0;
+				ZAOLY_BATCH_LANES_LOOP
+				for (size_t lane = block; lane < block + lanes; ++lane)
+					bits |= magnitude(a_dividends[lane]) | a_divisors[lane] | magnitude(b_dividends[lane]) | b_divisors[lane];
+				_any = bits >= reduce_limit;
+				if (!_any)
+					return;
+				for (size_t lane = 0; lane < lanes; ++lane)
+				{
+					const size_t index = block + lane;
+					_wide[lane] = (magnitude(a_dividends[index]) | a_divisors[index] | magnitude(b_dividends[index]) | b_divisors[index]) >= reduce_limit;
+					if (!_wide[lane])
+						continue;
+					const value_type result = op(value_type(a_dividends[index], a_divisors[index]), value_type(b_dividends[index], b_divisors[index]));
+					_dividends[lane] = result.dividend();
+					_divisors[lane] = result.divisor();
+				}
+			}
+
+			void store(d_type* dividends, s_type* divisors) const
+			{
+				if (_any)
+					for (size_t lane = 0; lane < lanes; ++lane)
+						if (_wide[lane])
+						{
+							dividends[lane] = _dividends[lane];
+							divisors[lane] = _divisors[lane];
+						}
+			}
+
+		private:
+			bool _any;
+			bool _wide[lanes];
+			d_type _dividends[lanes];
+			s_type _divisors[lanes];
+		};
+
+		static void reduce_if_large(d_type* dividends, s_type* divisors) // One block
+		{
+			s_type large = 0;
+			ZAOLY_BATCH_LANES_LOOP
+			for (size_t lane = 0; lane < lanes; ++lane)
+				large |= (magnitude(dividends[lane]) | divisors[lane]) >= reduce_limit;
+			if (large)
+				reduce_block(dividends, divisors);
+		}
+
+		static void reduce_block(d_type* dividends, s_type* divisors) // Stein's algorithm lane by lane; consecutive lanes are independent, so an out-of-order core already overlaps their gcds, which a lockstep loop across lanes without vector count-trailing-zeros only slows with spills
+		{
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				const s_type factor = greatest_common_divisor(magnitude(dividends[lane]), divisors[lane]);
+				if (factor != 1)
+				{
+					dividends[lane] /= d_type(factor);
+					divisors[lane] /= factor;
+				}
+			}
+		}
+	};
+
+	template <typename d_type, typename s_type>
+	constexpr size_t rational_vector_kernel<d_type, s_type>::lanes;
+
+	template <typename d_type, typename s_type>
+	constexpr s_type rational_vector_kernel<d_type, s_type>::reduce_limit;
+
+	template <typename d_type, typename s_type>
+	class rational_vector // Rationals in structure-of-arrays layout, dividends and divisors in separate aligned arrays; entries may be unreduced, get and normalize reduce them
+	{
+	public:
+		using value_type = rational<d_type, s_type>;
+		using kernel = rational_vector_kernel<d_type, s_type>;
+
+		static constexpr size_t lanes = kernel::lanes;
+
+		rational_vector() {}
+
+		explicit rational_vector(size_t size) // Zeros
+		{
+			resize(size);
+		}
+
+		rational_vector(const std::vector<value_type>& values)
+		{
+			resize(values.size());
+			for (size_t index = 0; index < _size; ++index)
+			{
+				_dividends[index] = values[index].dividend();
+				_divisors[index] = values[index].divisor();
+			}
+		}
+
+		size_t size() const
+		{
+			return _size;
+		}
+
+		size_t padded_size() const // size() rounded up to whole blocks, the padding holds 0/1
+		{
+			return _dividends.size();
+		}
+
+		void resize(size_t size) // Existing entries are kept up to the new size, new entries are zero
+		{
+			const size_t padded = (size + lanes - 1) / lanes * lanes;
+			for (size_t index = size; index < std::min(_size, padded); ++index)
+			{
+				_dividends[index] = 0;
+				_divisors[index] = 1;
+			}
+			_dividends.resize(padded, d_type(0));
+			_divisors.resize(padded, s_type(1));
+			_size = size;
+		}
+
+		void push_back(const value_type& value)
+		{
+			resize(_size + 1);
+			_dividends[_size - 1] = value.dividend();
+			_divisors[_size - 1] = value.divisor();
+		}
+
+		value_type get(size_t index) const // Reduced
+		{
+			if (index >= _size)
+				throw subscript_out_of_range();
+			return value_type(_dividends[index], _divisors[index]);
+		}
+
+		value_type operator[](size_t index) const
+		{
+			return get(index);
+		}
+
+		void set(size_t index, const value_type& value)
+		{
+			if (index >= _size)
+				throw subscript_out_of_range();
+			_dividends[index] = value.dividend();
+			_divisors[index] = value.divisor();
+		}
+
+		d_type* dividends() // size() values followed by padding; divisors must stay positive
+		{
+			return _dividends.data();
+		}
+
+		const d_type* dividends() const
+		{
+			return _dividends.data();
+		}
+
+		s_type* divisors()
+		{
+			return _divisors.data();
+		}
+
+		const s_type* divisors() const
+		{
+			return _divisors.data();
+		}
+
+		void normalize() // Reduces every entry
+		{
+			for (size_t block = 0; block < _dividends.size(); block += lanes)
+				kernel::reduce_block(_dividends.data() + block, _divisors.data() + block);
+		}
+
+		std::vector<value_type> to_vector() const
+		{
+			std::vector<value_type> result;
+			result.reserve(_size);
+			for (size_t index = 0; index < _size; ++index)
+				result.emplace_back(_dividends[index], _divisors[index]);
+			return result;
+		}
+
+		value_type sum() const // Unreduced, so runs of equal divisors add as plain integers
+		{
+			rational_accumulator<d_type, s_type> total;
+			for (size_t index = 0; index < _size; ++index)
+				total += rational_accumulator<d_type, s_type>(_dividends[index], _divisors[index]);
+			return total.value();
+		}
+
+		rational_vector& operator+=(const rational_vector& other)
+		{
+			add_into(*this, *this, other);
+			return *this;
+		}
+
+		rational_vector& operator-=(const rational_vector& other)
+		{
+			subtract_into(*this, *this, other);
+			return *this;
+		}
+
+		rational_vector& operator*=(const rational_vector& other)
+		{
+			multiply_into(*this, *this, other);
+			return *this;
+		}
+
+		rational_vector& operator/=(const rational_vector& other)
+		{
+			divide_into(*this, *this, other);
+			return *this;
+		}
+
+	private:
+		std::vector<d_type, aligned_allocator<d_type>> _dividends;
+		std::vector<s_type, aligned_allocator<s_type>> _divisors;
+		size_t _size = 0;
+	};
+
+	template <typename d_type, typename s_type>
+	constexpr size_t rational_vector<d_type, s_type>::lanes;
+
+	template <typename d_type, typename s_type>
+	void add_into(rational_vector<d_type, s_type>& result, const rational_vector<d_type, s_type>& a, const rational_vector<d_type, s_type>& b) // result may be a or b
+	{
+		if (a.size() != b.size())
+			throw matrix_unaligned();
+		result.resize(a.size());
+		rational_vector_kernel<d_type, s_type>::add_blocks(a.padded_size(), a.dividends(), a.divisors(), b.dividends(), b.divisors(), result.dividends(), result.divisors(), false);
+	}
+
+	template <typename d_type, typename s_type>
+	void subtract_into(rational_vector<d_type, s_type>& result, const rational_vector<d_type, s_type>& a, const rational_vector<d_type, s_type>& b)
+	{
+		if (a.size() != b.size())
+			throw matrix_unaligned();
+		result.resize(a.size());
+		rational_vector_kernel<d_type, s_type>::add_blocks(a.padded_size(), a.dividends(), a.divisors(), b.dividends(), b.divisors(), result.dividends(), result.divisors(), true);
+	}
+
+	template <typename d_type, typename s_type>
+	void multiply_into(rational_vector<d_type, s_type>& result, const rational_vector<d_type, s_type>& a, const rational_vector<d_type, s_type>& b)
+	{
+		if (a.size() != b.size())
+			throw matrix_unaligned();
+		result.resize(a.size());
+		rational_vector_kernel<d_type, s_type>::multiply_blocks(a.padded_size(), a.dividends(), a.divisors(), b.dividends(), b.divisors(), result.dividends(), result.divisors());
+	}
+
+	template <typename d_type, typename s_type>
+	void divide_into(rational_vector<d_type, s_type>& result, const rational_vector<d_type, s_type>& a, const rational_vector<d_type, s_type>& b) // Every entry of b nonzero
+	{
+		if (a.size() != b.size())
+			throw matrix_unaligned();
+		result.resize(a.size());
+		rational_vector_kernel<d_type, s_type>::divide_blocks(a.padded_size(), a.dividends(), a.divisors(), b.dividends(), b.divisors(), result.dividends(), result.divisors());
+	}
+
+	template <typename d_type, typename s_type>
+	void compare_into(std::vector<int>& results, const rational_vector<d_type, s_type>& a, const rational_vector<d_type, s_type>& b) // -1, 0 or 1 per entry as a < b, a == b or a > b
+	{
+		if (a.size() != b.size())
+			throw matrix_unaligned();
+		results.resize(a.size());
+		rational_vector_kernel<d_type, s_type>::compare_blocks(a.size(), a.dividends(), a.divisors(), b.dividends(), b.divisors(), results.data());
+	}
+
+	template <typename d_type, typename s_type>
+	rational_vector<d_type, s_type> operator+(const rational_vector<d_type, s_type>& a, const rational_vector<d_type, s_type>& b)
+	{
+		rational_vector<d_type, s_type> result;
+		add_into(result, a, b);
+		return result;
+	}
+
+	template <typename d_type, typename s_type>
+	rational_vector<d_type, s_type> operator-(const rational_vector<d_type, s_type>& a, const rational_vector<d_type, s_type>& b)
+	{
+		rational_vector<d_type, s_type> result;
+		subtract_into(result, a, b);
+		return result;
+	}
+
+	template <typename d_type, typename s_type>
+	rational_vector<d_type, s_type> operator*(const rational_vector<d_type, s_type>& a, const rational_vector<d_type, s_type>& b)
+	{
+		rational_vector<d_type, s_type> result;
+		multiply_into(result, a, b);
+		return result;
+	}
+
+	template <typename d_type, typename s_type>
+	rational_vector<d_type, s_type> operator/(const rational_vector<d_type, s_type>& a, const rational_vector<d_type, s_type>& b)
+	{
+		rational_vector<d_type, s_type> result;
+		divide_into(result, a, b);
+		return result;
+	}
+}
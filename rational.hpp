@@ -1,30 +1,309 @@
 #pragma once
 
+#include <cctype>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#ifndef ZAOLY_RATIONAL_CHECKED
+#define ZAOLY_RATIONAL_CHECKED 0 // 1 makes rational arithmetic throw rational_overflow instead of wrapping when a value does not fit
+#endif
 
 namespace zaoly
 {
+#if defined(__GNUC__) || defined(__clang__)
+#define ZAOLY_CTZ_CONSTEXPR constexpr // __builtin_ctzll works in constant expressions
+#else
+#define ZAOLY_CTZ_CONSTEXPR inline // The MSVC intrinsics do not, so rational reduces at run time only there; static_rational has its own constexpr gcd
+#endif
+
+	ZAOLY_CTZ_CONSTEXPR int count_trailing_zeros(unsigned long long value) // value != 0
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_ctzll(value);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return int(index);
+#elif defined(_MSC_VER)
+		unsigned long index;
+		if (_BitScanForward(&index, (unsigned long)value))
+			return int(index);
+		_BitScanForward(&index, (unsigned long)(value >> 32));
+		return int(index) + 32;
+#else
+		int count = 0;
+		for (; (value & 1) == 0; value >>= 1)
+			++count;
+		return count;
+#endif
+	}
+
+	ZAOLY_CTZ_CONSTEXPR int count_trailing_zeros(unsigned long value)
+	{
+		return count_trailing_zeros((unsigned long long)value);
+	}
+
+	ZAOLY_CTZ_CONSTEXPR int count_trailing_zeros(unsigned int value)
+	{
+		return count_trailing_zeros((unsigned long long)value);
+	}
+
+#undef ZAOLY_CTZ_CONSTEXPR
+
+	template <typename integer>
+	constexpr bool add_overflow(integer a, integer b, integer& result) // True when a + b does not fit, result is then unspecified
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_add_overflow(a, b, &result);
+#else
+		using limits = std::numeric_limits<integer>;
+		if (b > 0 ? a > limits::max() - b : a < limits::min() - b)
+			return true;
+		result = a + b;
+		return false;
+#endif
+	}
+
+	template <typename integer>
+	constexpr bool subtract_overflow(integer a, integer b, integer& result)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_sub_overflow(a, b, &result);
+#else
+		using limits = std::numeric_limits<integer>;
+		if (b > 0 ? a < limits::min() + b : a > limits::max() + b)
+			return true;
+		result = a - b;
+		return false;
+#endif
+	}
+
+	template <typename integer>
+	constexpr bool multiply_overflow(integer a, integer b, integer& result)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_mul_overflow(a, b, &result);
+#else
+		using limits = std::numeric_limits<integer>;
+		if (a > 0 ? (b > 0 ? a > limits::max() / b : b < limits::min() / a) : a < 0 && (b > 0 ? a < limits::min() / b : b < 0 && a < limits::max() / b))
+			return true;
+		result = a * b;
+		return false;
+#endif
+	}
+
+	template <typename integer, typename exponent_type>
+	constexpr bool pow_overflow(integer base, exponent_type exponent, integer& result) // True when base^exponent does not fit, result is then unspecified; stops at the first product that overflows
+	{
+		result = 1;
+		for (;;)
+		{
+			if ((exponent & 1) != 0 && multiply_overflow(result, base, result))
+				return true;
+			exponent >>= 1;
+			if (exponent == 0)
+				return false;
+			if (multiply_overflow(base, base, base))
+				return true;
+		}
+	}
+
+	template <typename integer>
+	constexpr integer binary_gcd(integer a, integer b) // Stein's binary algorithm on an unsigned type, shifts and subtractions only (gcd(0, b) = b)
+	{
+		if (a == 0)
+			return b;
+		if (b == 0)
+			return a;
+		const int a_zeros = count_trailing_zeros(a), b_zeros = count_trailing_zeros(b);
+		a >>= a_zeros;
+		b >>= b_zeros;
+		for (;;) // Both odd: the difference is even, and its trailing zeros are counted while the smaller operand is picked, without a branch on the order
+		{
+			const integer difference = b - a; // Wraps when b < a, which keeps the trailing zeros of |b - a|
+			if (difference == 0)
+				break;
+			const int zeros = count_trailing_zeros(difference);
+			const integer smaller = a < b ? a : b;
+			b = (a < b ? difference : a - b) >> zeros;
+			a = smaller;
+		}
+		return a << (a_zeros < b_zeros ? a_zeros : b_zeros);
+	}
+
+	template <typename integer>
+	constexpr integer greatest_common_divisor(integer a, integer b) // Greatest common divisor of the magnitudes, taken in the unsigned type so signed divisor types work and the subtractions may wrap (gcd(0, b) = |b|)
+	{
+		using unsigned_type = typename std::common_type<typename std::make_unsigned<integer>::type, unsigned>::type; // At least unsigned int, as narrower types promote to int in the subtractions
+		return integer(binary_gcd(a < 0 ? unsigned_type(0) - unsigned_type(a) : unsigned_type(a), b < 0 ? unsigned_type(0) - unsigned_type(b) : unsigned_type(b)));
+	}
+
+	template <typename left_type, typename right_type>
+	int compare_fractions(left_type a, left_type b, right_type c, right_type d) // Sign of a/b - c/d for a, c >= 0 and b, d > 0, through the continued fractions so no product can overflow
+	{
+		for (int sign = 1;; sign = -sign)
+		{
+			const left_type p = a / b;
+			const right_type q = c / d;
+			if (p != left_type(q))
+				return p < left_type(q) ? -sign : sign;
+			a -= p * b;
+			c -= q * d;
+			if (a == 0 || c == 0)
+				return a == 0 ? (c == 0 ? 0 : -sign) : sign;
+			std::swap(a, b); // Both fractional parts are positive, so a/b < c/d exactly when b/a > d/c
+			std::swap(c, d);
+		}
+	}
+
+	struct to_chars_result // As std::to_chars_result, which needs C++17
+	{
+		char* ptr;
+		std::errc ec;
+	};
+
+	struct from_chars_result
+	{
+		const char* ptr;
+		std::errc ec;
+	};
+
+	template <typename integer>
+	to_chars_result write_integer(char* first, char* last, integer value, std::true_type) // Decimal digits of a built-in integer, nothing is written when they do not fit
+	{
+		using unsigned_type = typename std::make_unsigned<integer>::type;
+		char digits[std::numeric_limits<unsigned_type>::digits10 + 2];
+		const bool negative = value < integer(0);
+		unsigned_type magnitude = negative ? unsigned_type(0) - unsigned_type(value) : unsigned_type(value);
+		char* const end = digits + sizeof(digits);
+		char* begin = end;
+		static const char pairs[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+			"404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899"; // Two digits per division
+		for (; magnitude >= 100; magnitude /= 100)
+		{
+			const size_t pair = size_t(magnitude % 100) * 2;
+			*--begin = pairs[pair + 1];
+			*--begin = pairs[pair];
+		}
+		if (magnitude >= 10)
+		{
+			*--begin = pairs[size_t(magnitude) * 2 + 1];
+			*--begin = pairs[size_t(magnitude) * 2];
+		}
+		else
+			*--begin = char('0' + magnitude);
+		if (negative)
+			*--begin = '-';
+		if (last - first < end - begin)
+			return { last, std::errc::value_too_large };
+		std::memcpy(first, begin, size_t(end - begin));
+		return { first + (end - begin), std::errc() };
+	}
+
+	template <typename integer>
+	to_chars_result write_integer(char* first, char* last, const integer& value, std::false_type)
+	{
+		return to_chars(first, last, value); // Found by argument-dependent lookup, class types such as bigint bring their own
+	}
+
+	template <typename integer>
+	from_chars_result read_integer(const char* first, const char* last, integer& value, std::true_type) // An optional '-' for signed types, then decimal digits; value is unchanged on error
+	{
+		using unsigned_type = typename std::make_unsigned<integer>::type;
+		const bool negative = std::is_signed<integer>::value && first != last && *first == '-';
+		const char* cursor = first + (negative ? 1 : 0);
+		const char* const digits = cursor;
+		unsigned_type magnitude = 0;
+		bool overflow = false;
+		for (; cursor != last && unsigned(*cursor - '0') < 10; ++cursor) // Digits past an overflow are still consumed, as std::from_chars does
+			overflow |= multiply_overflow(magnitude, unsigned_type(10), magnitude) || add_overflow(magnitude, unsigned_type(*cursor - '0'), magnitude);
+		if (cursor == digits)
+			return { first, std::errc::invalid_argument };
+		const unsigned_type limit = negative ? unsigned_type(0) - unsigned_type(std::numeric_limits<integer>::min()) : unsigned_type(std::numeric_limits<integer>::max());
+		if (overflow || magnitude > limit)
+			return { cursor, std::errc::result_out_of_range };
+		value = negative ? integer(unsigned_type(0) - magnitude) : integer(magnitude);
+		return { cursor, std::errc() };
+	}
+
+	template <typename integer>
+	from_chars_result read_integer(const char* first, const char* last, integer& value, std::false_type)
+	{
+		return from_chars(first, last, value);
+	}
+
+	template <typename d_type, typename s_type>
+	class rational;
+
+	template <typename d_type, typename s_type>
+	to_chars_result to_chars(char* first, char* last, const rational<d_type, s_type>& num) // "d/s" without a terminator, like std::to_chars: { last, value_too_large } when it does not fit
+	{
+		const to_chars_result dividend = write_integer(first, last, num.dividend(), std::is_arithmetic<d_type>());
+		if (dividend.ec != std::errc() || dividend.ptr == last)
+			return { last, std::errc::value_too_large };
+		*dividend.ptr = '/';
+		const to_chars_result divisor = write_integer(dividend.ptr + 1, last, num.divisor(), std::is_arithmetic<s_type>());
+		if (divisor.ec != std::errc())
+			return { last, std::errc::value_too_large };
+		return divisor;
+	}
+
+	template <typename d_type, typename s_type>
+	from_chars_result from_chars(const char* first, const char* last, rational<d_type, s_type>& num) // "d/s" with an optional '-' before d, like std::from_chars: num is unchanged on error, a zero divisor is invalid
+	{
+		d_type d;
+		s_type s;
+		from_chars_result result = read_integer(first, last, d, std::is_arithmetic<d_type>());
+		if (result.ec != std::errc())
+			return result;
+		if (result.ptr == last || *result.ptr != '/')
+			return { first, std::errc::invalid_argument };
+		result = read_integer(result.ptr + 1, last, s, std::is_arithmetic<s_type>());
+		if (result.ec == std::errc::invalid_argument || (result.ec == std::errc() && !(s > 0)))
+			return { first, std::errc::invalid_argument };
+		if (result.ec == std::errc())
+			num.set(d, s);
+		return result;
+	}
+
 	template <typename d_type, typename s_type>
 	class rational // Rational number, an integer divided by a positive integer (always the simplest form, that is, irreducible)
 	{
 	public:
-		rational(d_type d = 0, s_type s = 1) noexcept
+		using dividend_type = d_type;
+		using divisor_type = s_type;
+
+		constexpr rational(d_type d = 0, s_type s = 1) noexcept : r_dividend(d), r_divisor(s)
 		{
-			set(d, s);
+			reduce();
 		}
 
-		void set(d_type d, s_type s = 1) noexcept
+		template <typename integer, typename dividend = d_type, typename = typename std::enable_if<std::is_integral<integer>::value && std::is_class<dividend>::value>::type>
+		constexpr rational(integer d) noexcept : rational(dividend(d)) {} // A built-in integer converts in one step when d_type is a class such as bigint
+
+		constexpr void set(d_type d, s_type s = 1) noexcept
 		{
 			r_dividend = d;
 			r_divisor = s;
 			reduce();
 		}
 
-		void set_div(d_type d, d_type s) noexcept
+		constexpr void set_div(d_type d, d_type s) noexcept
 		{
 			if (s >= 0)
 			{
@@ -39,105 +318,84 @@ namespace zaoly
 			reduce();
 		}
 
-		class rational_format_error : public std::exception
+		class rational_format_error : public std::runtime_error
 		{
 		public:
-			rational_format_error() : std::exception("Rational number format error") {}
+			rational_format_error() : std::runtime_error("Rational number format error") {}
 		};
 
-		void set(const char* expression) // Set by string like "3/5", "-11/7", "7/1", "0/1"
+		class rational_overflow : public std::runtime_error // Thrown by arithmetic when ZAOLY_RATIONAL_CHECKED is 1
 		{
-			std::stringstream strstrm("");
-			d_type d = 0;
-			char slash = '\0';
-			s_type s = 0;
-			strstrm << expression;
-			strstrm.exceptions(std::ios::failbit);
-			strstrm >> d >> slash;
-			if (slash != '/')
+		public:
+			rational_overflow() : std::runtime_error("Rational number overflow") {}
+		};
+
+		class rational_io_error : public std::runtime_error // Thrown by load_rationals when the file cannot be opened or read
+		{
+		public:
+			rational_io_error() : std::runtime_error("Rational file cannot be read") {}
+		};
+
+		void set(const char* expression) // Set by string like "3/5", "-11/7", "+7 / 1", "0/1"; as with stream extraction, whitespace around either number and a leading '+' are allowed
+		{
+			const char* cursor = expression, * const last = expression + std::strlen(expression);
+			d_type d;
+			s_type s;
+			if (!read_term(cursor, last, d) || cursor == last || *cursor++ != '/' || !read_term(cursor, last, s) || cursor != last || !(s > 0))
 				throw rational_format_error();
-			strstrm >> s;
 			set(d, s);
 		}
 
-		void estimate(double num, s_type max_divisor = 1) // Find the closest fraction to a decimal
+		void estimate(double num, s_type max_divisor = 1) // Find the closest fraction to a decimal: a finite double is exactly p / 2^k, whose continued fraction takes O(log max_divisor) steps
 		{
-			d_type d1 = 0, d2 = 0, d = 0, best_d = 0;
-			s_type s = 0, best_s = 1;
-			double error = 0.0, min_error = 0.0;
-			d1 = ceil(num - 0.5);
-			d2 = floor(num + 0.5);
-			if (d1 == d2 || half_dilemma(d1, d2, 1))
-				best_d = d1;
-			else
-				best_d = d2;
-			min_error = abs(num - best_d);
-			for (s = 2; s <= max_divisor; ++s)
+			using remainder_type = typename std::conditional<std::is_arithmetic<s_type>::value, unsigned long long, s_type>::type;
+			int exponent = 0;
+			const double mantissa = std::frexp(std::abs(num), &exponent);
+			remainder_type p = remainder_type(static_cast<unsigned long long>(std::ldexp(mantissa, 53)));
+			int shift = 53 - exponent; // |num| = p / 2^shift
+			while (shift > 0 && (p & 1) == 0)
 			{
-				d1 = ceil(num * s - 0.5);
-				d2 = floor(num * s + 0.5);
-				if (d1 == d2 || half_dilemma(d1, d2, s))
-					d = d1;
-				else
-					d = d2;
-				error = abs(num - double(d) / double(s));
-				if (error < min_error)
-				{
-					min_error = error;
-					best_d = d;
-					best_s = s;
-				}
+				p >>= 1;
+				--shift;
+			}
+			if (shift <= 0)
+			{
+				d_type value = d_type(p);
+				for (; shift < 0; ++shift)
+					value *= 2;
+				set(num < 0 ? -value : value);
+				return;
 			}
-			set(best_d, best_s);
+			const int limit = std::numeric_limits<remainder_type>::is_bounded ? std::numeric_limits<remainder_type>::digits - 1 : std::numeric_limits<int>::max();
+			if (shift > limit) // 2^shift does not fit, num is rounded to a multiple of 2^-limit first
+			{
+				p = shift - limit > 53 ? remainder_type(0) : ((p >> (shift - limit - 1)) + 1) >> 1;
+				shift = limit;
+			}
+			approximate(p, remainder_type(1) << shift, num < 0, max_divisor);
 		}
 
 		void estimate(const rational& num, s_type max_divisor = 1) // Find the closest fraction to a rational number
 		{
-			d_type d1 = 0, d2 = 0, d = 0, best_d = 0;
-			s_type s = 0, best_s = 1;
-			rational error = 0, min_error = 0;
-			d1 = ceil(num - rational(1, 2));
-			d2 = floor(num + rational(1, 2));
-			if (d1 == d2 || half_dilemma(d1, d2, 1))
-				best_d = d1;
-			else
-				best_d = d2;
-			min_error = abs(num - best_d);
-			for (s = 2; s <= max_divisor; ++s)
-			{
-				d1 = ceil(num * s - rational(1, 2));
-				d2 = floor(num * s + rational(1, 2));
-				if (d1 == d2 || half_dilemma(d1, d2, s))
-					d = d1;
-				else
-					d = d2;
-				error = abs(num - rational(d, s));
-				if (error < min_error)
-				{
-					min_error = error;
-					best_d = d;
-					best_s = s;
-				}
-			}
-			set(best_d, best_s);
+			approximate(magnitude(num.r_dividend), num.r_divisor, num.r_dividend < 0, max_divisor);
 		}
 
-		d_type dividend() const
+		constexpr d_type dividend() const
 		{
 			return r_dividend;
 		}
 
-		s_type divisor() const
+		constexpr s_type divisor() const
 		{
 			return r_divisor;
 		}
 
-		d_type int_part() const
+		constexpr d_type int_part() const
 		{
 			return r_dividend / (d_type)r_divisor;
 		}
 
-		rational proper_part() const
+		constexpr rational proper_part() const
 		{
 			return rational(r_dividend % (d_type)r_divisor, r_divisor);
 		}
@@ -147,102 +405,104 @@ namespace zaoly
 			os << r_dividend << '/' << r_divisor;
 		}
 
-		float to_float() const
+		constexpr float to_float() const
 		{
 			return (float)r_dividend / (float)r_divisor;
 		}
 
-		double to_double() const
+		constexpr double to_double() const
 		{
 			return (double)r_dividend / (double)r_divisor;
 		}
 
-		char* to_cstr(char* buffer, size_t size) const
+		char* to_cstr(char* buffer, size_t size) const // Null-terminated, or empty when it does not fit
 		{
-			std::stringstream strstrm;
-			strstrm << r_dividend << '/' << r_divisor;
-			strcpy_s(buffer, size, strstrm.str().c_str());
+			if (size == 0)
+				return buffer;
+			const to_chars_result result = zaoly::to_chars(buffer, buffer + size - 1, *this);
+			*(result.ec == std::errc() ? result.ptr : buffer) = '\0';
 			return buffer;
 		}
 
 		std::string to_str() const
 		{
-			std::stringstream strstrm;
-			strstrm << r_dividend << '/' << r_divisor;
+			char buffer[64]; // Two 64-bit integers and the slash
+			const to_chars_result result = zaoly::to_chars(buffer, buffer + sizeof(buffer), *this);
+			if (result.ec == std::errc())
+				return std::string(buffer, result.ptr);
+			std::stringstream strstrm; // Wider integer types
+			print(strstrm);
 			return strstrm.str();
 		}
 
-		rational operator+() const // Positive
+		constexpr rational operator+() const // Positive
 		{
 			return rational(r_dividend, r_divisor);
 		}
 
-		rational operator-() const // Negative
+		constexpr rational operator-() const // Negative
 		{
-			return rational(-r_dividend, r_divisor);
+			rational result = *this;
+			result.r_dividend = subtract(d_type(0), r_dividend);
+			return result;
 		}
 
-		rational& operator++()
+		constexpr rational& operator++() // (a + b) / b is irreducible whenever a / b is
 		{
-			r_dividend += r_divisor;
-			reduce();
+			r_dividend = add(r_dividend, to_dividend(r_divisor));
 			return *this;
 		}
 
-		rational operator++(int)
+		constexpr rational operator++(int)
 		{
 			rational result = *this;
-			r_dividend += r_divisor;
-			reduce();
+			++*this;
 			return result;
 		}
 
-		rational& operator--()
+		constexpr rational& operator--()
 		{
-			r_dividend -= r_divisor;
-			reduce();
+			r_dividend = subtract(r_dividend, to_dividend(r_divisor));
 			return *this;
 		}
 
-		rational operator--(int)
+		constexpr rational operator--(int)
 		{
 			rational result = *this;
-			r_dividend -= r_divisor;
-			reduce();
+			--*this;
 			return result;
 		}
 
-		rational& operator+=(const rational& num)
+		constexpr rational& operator+=(const rational& num)
 		{
-			return *this = *this + num;
+			return accumulate(num, false);
 		}
 
-		rational& operator-=(const rational& num)
+		constexpr rational& operator-=(const rational& num)
 		{
-			return *this = *this - num;
+			return accumulate(num, true);
 		}
 
-		rational& operator*=(const rational& num)
+		constexpr rational& operator*=(const rational& num) // Cross-cancelled first, a/b * c/d = (a/g1 * c/g2) / (b/g2 * d/g1) with g1 = gcd(a, d), g2 = gcd(c, b), already irreducible
 		{
-			r_dividend *= num.r_dividend;
-			r_divisor *= num.r_divisor;
-			reduce();
+			if (r_dividend == 0 || num.r_dividend == 0)
+				return *this = rational();
+			const s_type g1 = gcd(magnitude(r_dividend), num.r_divisor), g2 = gcd(magnitude(num.r_dividend), r_divisor);
+			r_dividend = multiply(r_dividend / to_dividend(g1), num.r_dividend / to_dividend(g2));
+			r_divisor = multiply(r_divisor / g2, num.r_divisor / g1);
 			return *this;
 		}
 
-		rational& operator/=(const rational& num)
+		constexpr rational& operator/=(const rational& num) // Cross-cancelled like *=, the sign of c moves to the dividend (c != 0)
 		{
-			if (num.r_dividend >= 0)
-			{
-				r_dividend *= num.r_divisor;
-				r_divisor *= num.r_dividend;
-			}
-			else
-			{
-				r_dividend *= -(d_type)num.r_divisor;
-				r_divisor *= -num.r_dividend;
-			}
-			reduce();
+			if (r_dividend == 0)
+				return *this;
+			const s_type c = magnitude(num.r_dividend);
+			const s_type g1 = gcd(magnitude(r_dividend), c), g2 = gcd(num.r_divisor, r_divisor);
+			r_dividend = multiply(r_dividend / to_dividend(g1), to_dividend(num.r_divisor / g2));
+			r_divisor = multiply(r_divisor / g2, c / g1);
+			if (num.r_dividend < 0)
+				r_dividend = subtract(d_type(0), r_dividend);
 			return *this;
 		}
 
@@ -255,18 +515,98 @@ namespace zaoly
 		d_type r_dividend; // Signed
 		s_type r_divisor;  // Unsigned (positive)
 
-		s_type gcd(s_type a, s_type b) const // Greatest common divisor (error when b = 0)
+		template <typename integer>
+		static bool read_term(const char*& cursor, const char* last, integer& value) // One number of set(const char*) with the whitespace around it and an optional '+', cursor moves past them
 		{
-			if (a % b == 0)
-				return b;
-			else
-				return gcd(b, a % b);
+			while (cursor != last && std::isspace((unsigned char)*cursor))
+				++cursor;
+			if (cursor != last && *cursor == '+' && ++cursor != last && unsigned(*cursor - '0') >= 10)
+				return false;
+			const from_chars_result result = read_integer(cursor, last, value, std::is_arithmetic<integer>());
+			if (result.ec != std::errc())
+				return false;
+			cursor = result.ptr;
+			while (cursor != last && std::isspace((unsigned char)*cursor))
+				++cursor;
+			return true;
+		}
+
+		static constexpr s_type gcd(s_type a, s_type b) // gcd(0, b) = b
+		{
+			return greatest_common_divisor(a, b); // Found by argument-dependent lookup for class types, so an integer type can bring its own algorithm
+		}
+
+		static constexpr s_type magnitude(d_type d) // |d| computed in the unsigned type, so the most negative value does not overflow
+		{
+			return d < 0 ? s_type(0) - s_type(d) : s_type(d);
+		}
+
+		static constexpr d_type to_dividend(s_type s)
+		{
+#if ZAOLY_RATIONAL_CHECKED
+			if (std::numeric_limits<d_type>::is_bounded && s > s_type(std::numeric_limits<d_type>::max()))
+				throw rational_overflow();
+#endif
+			return d_type(s);
+		}
+
+		template <typename integer>
+		static constexpr integer add(integer a, integer b)
+		{
+#if ZAOLY_RATIONAL_CHECKED
+			integer result{};
+			if (add_overflow(a, b, result))
+				throw rational_overflow();
+			return result;
+#else
+			return a + b;
+#endif
 		}
 
-		void reduce() // Reduce fraction to the simplest form
+		template <typename integer>
+		static constexpr integer subtract(integer a, integer b)
 		{
-			s_type factor = gcd(abs(r_dividend), r_divisor);
-			r_dividend /= (d_type)factor;
+#if ZAOLY_RATIONAL_CHECKED
+			integer result{};
+			if (subtract_overflow(a, b, result))
+				throw rational_overflow();
+			return result;
+#else
+			return a - b;
+#endif
+		}
+
+		template <typename integer>
+		static constexpr integer multiply(integer a, integer b)
+		{
+#if ZAOLY_RATIONAL_CHECKED
+			integer result{};
+			if (multiply_overflow(a, b, result))
+				throw rational_overflow();
+			return result;
+#else
+			return a * b;
+#endif
+		}
+
+		constexpr rational& accumulate(const rational& num, bool negative) // a/b +- c/d with g = gcd(b, d): (a * d/g +- c * b/g) / (b/g * d), and only gcd(t, g) can still divide the result t
+		{
+			const s_type g = gcd(r_divisor, num.r_divisor);
+			const s_type b_part = r_divisor / g, d_part = num.r_divisor / g;
+			const d_type left = multiply(r_dividend, to_dividend(d_part)), right = multiply(num.r_dividend, to_dividend(b_part));
+			const d_type t = negative ? subtract(left, right) : add(left, right);
+			if (t == 0)
+				return *this = rational();
+			const s_type factor = g == 1 ? s_type(1) : gcd(magnitude(t), g);
+			r_dividend = t / to_dividend(factor);
+			r_divisor = multiply(b_part, num.r_divisor / factor);
+			return *this;
+		}
+
+		constexpr void reduce() // Reduce fraction to the simplest form
+		{
+			const s_type factor = gcd(magnitude(r_dividend), r_divisor);
+			r_dividend /= to_dividend(factor);
 			r_divisor /= factor;
 		}
 
@@ -293,10 +633,71 @@ namespace zaoly
 		 * The same is true for estimating according to a fraction.
 		 */
 
+		template <typename integer>
+		void approximate(integer p, integer q, bool negative, s_type max_divisor) // Closest fraction to (negative ? -p : p) / q with a divisor at most max_divisor, ties broken as the exhaustive search over divisors would
+		{
+			// The answer is one of the two neighbours of p/q among such fractions: the last convergent h1/k1 within the bound,
+			// or the semiconvergent (h0 + t * h1) / (k0 + t * k1) with the largest t that keeps the divisor within the bound
+			const s_type bound = max_divisor < 1 ? s_type(1) : max_divisor;
+			d_type h0 = 1, h1 = d_type(p / q);
+			s_type k0 = 0, k1 = 1;
+			integer current = q, next = p % q; // The rest of the continued fraction is current / next
+			integer term = 0;
+			s_type t = 0;
+			for (;;)
+			{
+				if (next == 0) // p/q itself is within the bound
+				{
+					set(negative ? -h1 : h1, k1);
+					return;
+				}
+				term = current / next;
+				t = (bound - k0) / k1;
+				if (term > integer(t))
+					break;
+				const s_type a = s_type(term);
+				const d_type h = d_type(a) * h1 + h0;
+				const s_type k = a * k1 + k0;
+				h0 = h1;
+				h1 = h;
+				k0 = k1;
+				k1 = k;
+				const integer rest = current - term * next;
+				current = next;
+				next = rest;
+			}
+			// With r = current / next = term + f, the semiconvergent is closer exactly when r - 2t < k0 / k1, and as close when equal
+			const d_type h2 = d_type(t) * h1 + h0;
+			const s_type k2 = t * k1 + k0;
+			const integer excess = term - integer(t), fraction = current - term * next; // r - 2t = (excess - t) + fraction / next
+			int order; // Sign of (r - 2t) - k0 / k1
+			if (excess < integer(t))
+				order = -1;
+			else if (excess == integer(t))
+				order = compare_fractions(fraction, next, k0, k1);
+			else if (excess - 1 == integer(t))
+				order = k0 < k1 || fraction != 0 ? 1 : 0;
+			else
+				order = 1;
+			if (order == 0)
+				order = k1 < k2 ? 1 : k2 < k1 ? -1 : 0;
+			d_type d1 = negative ? -h1 : h1, d2 = negative ? -h2 : h2;
+			if (order == 0) // Same divisor, the lower numerator first as in half_dilemma
+			{
+				if (d2 < d1)
+					std::swap(d1, d2);
+				set(half_dilemma(d1, d2, k1) ? d1 : d2, k1);
+			}
+			else if (order > 0)
+				set(d1, k1);
+			else
+				set(d2, k2);
+		}
+
 		bool half_dilemma(d_type d1, d_type d2, s_type s) const
 		{
 			rational r1(d1, s), r2(d2, s);
-			return abs(r1.r_dividend) + r1.r_divisor <= abs(r2.r_dividend) + r2.r_divisor;
+			return magnitude(r1.r_dividend) + r1.r_divisor <= magnitude(r2.r_dividend) + r2.r_divisor;
 		}
 	};
 
@@ -310,110 +711,185 @@ namespace zaoly
 			if (new_exponent & 1)
 				result *= value;
 			new_exponent >>= 1;
-			value *= value;
+			if (new_exponent > 0) // The square after the last bit would be the largest product and is never used
+				value *= value;
 		}
 		return result;
 	}
 
+	template <typename integer, typename exponent_type>
+	integer root_estimate(const integer& radicand, exponent_type exponent, std::true_type) // Floating-point estimate of radicand^(1/exponent), within one or two of the root
+	{
+		return integer(std::pow(double(radicand), 1 / double(exponent)));
+	}
+
+	template <typename integer, typename exponent_type>
+	integer root_estimate(const integer& radicand, exponent_type exponent, std::false_type) // From the leading 64 bits and the bit length, so no conversion to double overflows
+	{
+		const size_t bits = radicand.bit_length(), shift = bits > 64 ? bits - 64 : 0;
+		const double exponent2 = (std::log2(double(radicand >> shift)) + double(shift)) / double(exponent); // log2 of the root
+		if (exponent2 < 62)
+			return integer((unsigned long long)std::exp2(exponent2));
+		const size_t low = size_t(exponent2) - 52; // Bits below the precision of the estimate
+		return integer((unsigned long long)std::exp2(exponent2 - double(low))) << low;
+	}
+
+	template <typename integer, bool = std::is_integral<integer>::value>
+	struct root_magnitude // |radicand| for the roots of negative numbers, in the unsigned type of a built-in integer so the most negative value negates without overflow
+	{
+		using type = typename std::make_unsigned<integer>::type;
+
+		static type of(integer value)
+		{
+			return value < 0 ? type(0) - type(value) : type(value);
+		}
+
+		static integer with_sign(type magnitude, bool negative)
+		{
+			return integer(negative ? type(0) - magnitude : magnitude);
+		}
+	};
+
+	template <typename integer>
+	struct root_magnitude<integer, false> // Class types such as bigint negate every value
+	{
+		using type = integer;
+
+		static type of(const integer& value)
+		{
+			return value < 0 ? -value : value;
+		}
+
+		static integer with_sign(const type& magnitude, bool negative)
+		{
+			return negative ? -magnitude : magnitude;
+		}
+	};
+
+	template <typename integer, typename exponent_type>
+	integer floor_root(const integer& radicand, exponent_type exponent) // floor(radicand^(1/exponent)) for radicand >= 0 and exponent >= 1, refined from a floating-point estimate
+	{
+		if (exponent == 1 || radicand < 2)
+			return radicand;
+		integer root = root_estimate(radicand, exponent, std::is_arithmetic<integer>());
+		if (std::numeric_limits<integer>::is_bounded) // The estimate is close, and powers checked for overflow correct it
+		{
+			integer power;
+			while (root > 0 && (pow_overflow(root, exponent, power) || power > radicand))
+				--root;
+			while (!pow_overflow(integer(root + 1), exponent, power) && power <= radicand)
+				++root;
+			return root;
+		}
+		// Newton's method: one step from any positive estimate lands at or above the root, and from there the steps decrease to it
+		const exponent_type less = exponent - 1;
+		if (root < 1)
+			root = 1;
+		root = (root * integer(less) + radicand / fast_pow(root, less)) / integer(exponent);
+		for (;;)
+		{
+			const integer next = (root * integer(less) + radicand / fast_pow(root, less)) / integer(exponent);
+			if (next >= root)
+				return root;
+			root = next;
+		}
+	}
+
 	template <typename d_type, typename s_type>
-	d_type fast_root(d_type radicand, s_type exponent) // Fast root
+	d_type fast_root(d_type radicand, s_type exponent) // Fast root, truncated toward zero
 	{
-		d_type left = 0, right = 0, addend = 0, mid = 0;
-		if (exponent <= 0 || radicand < 0 && (exponent & 1) == 0)
+		if (exponent <= 0 || (radicand < 0 && (exponent & 1) == 0))
 			throw exponent;
-		left = 1;
-		right = 2;
-		if (radicand > 0)
+		return root_magnitude<d_type>::with_sign(floor_root(root_magnitude<d_type>::of(radicand), exponent), radicand < 0);
+	}
+
+	template <typename d_type, typename s_type>
+	bool exact_root(d_type radicand, s_type exponent, d_type& root) // True and the root when radicand is a perfect power; false, leaving root unchanged, otherwise or for an even root of a negative number
+	{
+		if (exponent <= 0 || (radicand < 0 && (exponent & 1) == 0))
+			return false;
+		const typename root_magnitude<d_type>::type magnitude = root_magnitude<d_type>::of(radicand), result = floor_root(magnitude, exponent);
+		if (fast_pow(result, exponent) != magnitude)
+			return false;
+		root = root_magnitude<d_type>::with_sign(result, radicand < 0);
+		return true;
+	}
+
+	template <typename d_type, typename s_type>
+	bool exact_pow(const rational<d_type, s_type>& base, const rational<d_type, s_type>& exponent, rational<d_type, s_type>& result) // base^exponent when it is rational; the roots are taken first, so the power overflows only when the result does; false, leaving result unchanged, when it is irrational or not real, or for 0 to a negative power
+	{
+		const d_type p = exponent.dividend();
+		const s_type q = exponent.divisor();
+		if (p == 0)
 		{
-			while (fast_pow(right, exponent) <= radicand)
-			{
-				left <<= 1;
-				right <<= 1;
-			}
-			addend = left;
-			mid = left;
-			while (addend > 1)
-			{
-				addend >>= 1;
-				mid = left | addend;
-				if (fast_pow(mid, exponent) <= radicand)
-					left = mid;
-			}
-			return left;
+			result = 1;
+			return true;
 		}
-		else if (radicand < 0)
+		if (base.dividend() == 0)
 		{
-			while (fast_pow(right, exponent) <= -radicand)
-			{
-				left <<= 1;
-				right <<= 1;
-			}
-			addend = left;
-			mid = left;
-			while (addend > 1)
-			{
-				addend >>= 1;
-				mid = left | addend;
-				if (fast_pow(mid, exponent) <= -radicand)
-					left = mid;
-			}
-			return -left;
+			if (p < 0)
+				return false;
+			result = 0;
+			return true;
 		}
+		d_type dividend_root = 0;
+		s_type divisor_root = 0;
+		if (!exact_root(base.dividend(), q, dividend_root) || !exact_root(base.divisor(), q, divisor_root))
+			return false;
+		const s_type power = p < 0 ? s_type(0) - s_type(p) : s_type(p);
+		d_type dividend;
+		s_type divisor;
+		if (pow_overflow(dividend_root, power, dividend) || pow_overflow(divisor_root, power, divisor))
+		{
+#if ZAOLY_RATIONAL_CHECKED
+			throw typename rational<d_type, s_type>::rational_overflow();
+#else
+			dividend = fast_pow(dividend_root, power); // Wraps like the other operators
+			divisor = fast_pow(divisor_root, power);
+#endif
+		}
+		if (p > 0)
+			result.set(dividend, divisor);
 		else
-			return 0;
+			result.set_div(d_type(divisor), dividend);
+		return true;
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> operator+(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b) // Addition: a/b + c/d = (ad+bc)/(bd)
+	constexpr rational<d_type, s_type> operator+(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b) // Addition: a/b + c/d = (ad+bc)/(bd)
 	{
-		return rational<d_type, s_type>
-		(
-			a.dividend() * (d_type)b.divisor() + (d_type)a.divisor() * b.dividend(),
-			a.divisor() * b.divisor()
-		);
+		rational<d_type, s_type> result = a;
+		return result += b;
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> operator-(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b) // Subtraction: a/b - c/d = (ad-bc)/(bd)
+	constexpr rational<d_type, s_type> operator-(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b) // Subtraction: a/b - c/d = (ad-bc)/(bd)
 	{
-		return rational<d_type, s_type>
-		(
-			a.dividend() * (d_type)b.divisor() - (d_type)a.divisor() * b.dividend(),
-			a.divisor() * b.divisor()
-		);
+		rational<d_type, s_type> result = a;
+		return result -= b;
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> operator*(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b) // Multiplication: a/b * c/d = (ac)/(bd)
+	constexpr rational<d_type, s_type> operator*(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b) // Multiplication: a/b * c/d = (ac)/(bd)
 	{
-		return rational<d_type, s_type>
-		(
-			a.dividend() * b.dividend(),
-			a.divisor() * b.divisor()
-		);
+		rational<d_type, s_type> result = a;
+		return result *= b;
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> operator/(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b) // Division: a/b / c/d = (ad)/(bc) (c != 0)
+	constexpr rational<d_type, s_type> operator/(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b) // Division: a/b / c/d = (ad)/(bc) (c != 0)
 	{
-		if (b.dividend() >= 0)
-			return rational<d_type, s_type>
-			(
-				a.dividend() * (d_type)b.divisor(),
-				a.divisor() * b.dividend()
-			);
-		else
-			return rational<d_type, s_type>
-			(
-				-a.dividend() * (d_type)b.divisor(),
-				a.divisor() * -b.dividend()
-			);
+		rational<d_type, s_type> result = a;
+		return result /= b;
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> operator^(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b) // Power (newly added operator compared to C++ standard)
+	rational<d_type, s_type> operator^(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b) // Power (newly added operator compared to C++ standard); exact_pow tells whether the result is exact
 	{
-		if (b.dividend() > 0)
+		rational<d_type, s_type> result;
+		if (exact_pow(a, b, result))
+			return result;
+		if (b.dividend() > 0) // Not rational: the truncated roots of the powers
 			return rational<d_type, s_type>
 			(
 				fast_root<d_type, s_type>(fast_pow<d_type, s_type>(a.dividend(), b.dividend()), b.divisor()),
@@ -430,85 +906,85 @@ namespace zaoly
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator==(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b)
+	constexpr bool operator==(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b)
 	{
 		return a.dividend() == b.dividend() && a.divisor() == b.divisor();
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator!=(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b)
+	constexpr bool operator!=(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b)
 	{
 		return a.dividend() != b.dividend() || a.divisor() != b.divisor();
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator<(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b)
+	constexpr bool operator<(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b)
 	{
 		return a.dividend() * (d_type)b.divisor() < (d_type)a.divisor() * b.dividend();
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator>(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b)
+	constexpr bool operator>(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b)
 	{
 		return a.dividend() * (d_type)b.divisor() > (d_type)a.divisor() * b.dividend();
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator<=(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b)
+	constexpr bool operator<=(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b)
 	{
 		return a.dividend() * (d_type)b.divisor() <= (d_type)a.divisor() * b.dividend();
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator>=(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b)
+	constexpr bool operator>=(const rational<d_type, s_type>& a, const rational<d_type, s_type>& b)
 	{
 		return a.dividend() * (d_type)b.divisor() >= (d_type)a.divisor() * b.dividend();
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> operator+(const rational<d_type, s_type>& a, d_type b)
+	constexpr rational<d_type, s_type> operator+(const rational<d_type, s_type>& a, d_type b)
 	{
 		return a + rational<d_type, s_type>(b);
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> operator+(d_type a, const rational<d_type, s_type>& b)
+	constexpr rational<d_type, s_type> operator+(d_type a, const rational<d_type, s_type>& b)
 	{
 		return rational<d_type, s_type>(a) + b;
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> operator-(const rational<d_type, s_type>& a, d_type b)
+	constexpr rational<d_type, s_type> operator-(const rational<d_type, s_type>& a, d_type b)
 	{
 		return a - rational<d_type, s_type>(b);
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> operator-(d_type a, const rational<d_type, s_type>& b)
+	constexpr rational<d_type, s_type> operator-(d_type a, const rational<d_type, s_type>& b)
 	{
 		return rational<d_type, s_type>(a) - b;
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> operator*(const rational<d_type, s_type>& a, d_type b)
+	constexpr rational<d_type, s_type> operator*(const rational<d_type, s_type>& a, d_type b)
 	{
 		return a * rational<d_type, s_type>(b);
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> operator*(d_type a, const rational<d_type, s_type>& b)
+	constexpr rational<d_type, s_type> operator*(d_type a, const rational<d_type, s_type>& b)
 	{
 		return rational<d_type, s_type>(a) * b;
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> operator/(const rational<d_type, s_type>& a, d_type b)
+	constexpr rational<d_type, s_type> operator/(const rational<d_type, s_type>& a, d_type b)
 	{
 		return a / rational<d_type, s_type>(b);
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> operator/(d_type a, const rational<d_type, s_type>& b)
+	constexpr rational<d_type, s_type> operator/(d_type a, const rational<d_type, s_type>& b)
 	{
 		return rational<d_type, s_type>(a) / b;
 	}
@@ -526,101 +1002,287 @@ namespace zaoly
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator==(const rational<d_type, s_type>& a, d_type b)
+	constexpr bool operator==(const rational<d_type, s_type>& a, d_type b)
 	{
 		return a == rational<d_type, s_type>(b);
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator==(d_type a, const rational<d_type, s_type>& b)
+	constexpr bool operator==(d_type a, const rational<d_type, s_type>& b)
 	{
 		return rational<d_type, s_type>(a) == b;
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator!=(const rational<d_type, s_type>& a, d_type b)
+	constexpr bool operator!=(const rational<d_type, s_type>& a, d_type b)
 	{
 		return a != rational<d_type, s_type>(b);
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator!=(d_type a, const rational<d_type, s_type>& b)
+	constexpr bool operator!=(d_type a, const rational<d_type, s_type>& b)
 	{
 		return rational<d_type, s_type>(a) != b;
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator<(const rational<d_type, s_type>& a, d_type b)
+	constexpr bool operator<(const rational<d_type, s_type>& a, d_type b)
 	{
 		return a < rational<d_type, s_type>(b);
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator<(d_type a, const rational<d_type, s_type>& b)
+	constexpr bool operator<(d_type a, const rational<d_type, s_type>& b)
 	{
 		return rational<d_type, s_type>(a) < b;
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator>(const rational<d_type, s_type>& a, d_type b)
+	constexpr bool operator>(const rational<d_type, s_type>& a, d_type b)
 	{
 		return a > rational<d_type, s_type>(b);
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator>(d_type a, const rational<d_type, s_type>& b)
+	constexpr bool operator>(d_type a, const rational<d_type, s_type>& b)
 	{
 		return rational<d_type, s_type>(a) > b;
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator<=(const rational<d_type, s_type>& a, d_type b)
+	constexpr bool operator<=(const rational<d_type, s_type>& a, d_type b)
 	{
 		return a <= rational<d_type, s_type>(b);
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator<=(d_type a, const rational<d_type, s_type>& b)
+	constexpr bool operator<=(d_type a, const rational<d_type, s_type>& b)
 	{
 		return rational<d_type, s_type>(a) <= b;
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator>=(const rational<d_type, s_type>& a, d_type b)
+	constexpr bool operator>=(const rational<d_type, s_type>& a, d_type b)
 	{
 		return a >= rational<d_type, s_type>(b);
 	}
 
 	template <typename d_type, typename s_type>
-	bool operator>=(d_type a, const rational<d_type, s_type>& b)
+	constexpr bool operator>=(d_type a, const rational<d_type, s_type>& b)
 	{
 		return rational<d_type, s_type>(a) >= b;
 	}
 
 	template <typename d_type, typename s_type>
-	rational<d_type, s_type> abs(const rational<d_type, s_type>& num)
+	constexpr rational<d_type, s_type> abs(const rational<d_type, s_type>& num)
+	{
+		return num.dividend() < 0 ? -num : num;
+	}
+
+	template <typename d_type, typename s_type>
+	void estimate_into(rational<d_type, s_type>* results, const double* values, size_t count, typename rational<d_type, s_type>::divisor_type max_divisor = 1) // Closest fractions to an array of decimals, O(log max_divisor) each
+	{
+		for (size_t index = 0; index < count; ++index)
+			results[index].estimate(values[index], max_divisor);
+	}
+
+	template <typename d_type, typename s_type>
+	void estimate_into(std::vector<rational<d_type, s_type>>& results, const std::vector<double>& values, typename rational<d_type, s_type>::divisor_type max_divisor = 1)
 	{
-		return rational<d_type, s_type>(std::abs(num.dividend()), num.divisor());
+		results.resize(values.size());
+		estimate_into(results.data(), values.data(), values.size(), max_divisor);
 	}
 
 	template <typename d_type, typename s_type>
-	d_type floor(const rational<d_type, s_type>& num)
+	constexpr d_type floor(const rational<d_type, s_type>& num)
 	{
-		if (num.dividend() > 0 || num.dividend() % num.divisor() == 0)
-			return num.dividend() / num.divisor();
+		const d_type divisor = d_type(num.divisor()); // Signed, so negative dividends are not converted to unsigned
+		if (num.dividend() > 0 || num.dividend() % divisor == 0)
+			return num.dividend() / divisor;
 		else
-			return num.dividend() / num.divisor() - 1;
+			return num.dividend() / divisor - 1;
 	}
 
 	template <typename d_type, typename s_type>
-	d_type ceil(const rational<d_type, s_type>& num)
+	constexpr d_type ceil(const rational<d_type, s_type>& num)
 	{
-		if (num.dividend() > 0 && num.dividend() % num.divisor() != 0)
-			return num.dividend() / num.divisor() + 1;
+		const d_type divisor = d_type(num.divisor());
+		if (num.dividend() > 0 && num.dividend() % divisor != 0)
+			return num.dividend() / divisor + 1;
 		else
-			return num.dividend() / num.divisor();
+			return num.dividend() / divisor;
 	}
 
+	template <typename d_type, typename s_type>
+	class rational_accumulator // A rational kept unreduced between operations, for long sums where only the result is read; a gcd is paid on reading or where a product would overflow
+	{
+	public:
+		using value_type = rational<d_type, s_type>;
+
+		rational_accumulator(d_type d = 0, s_type s = 1) noexcept : _dividend(d), _divisor(s) {} // s > 0, need not be coprime with d
+
+		rational_accumulator(const value_type& num) noexcept : _dividend(num.dividend()), _divisor(num.divisor()) {}
+
+		d_type dividend() const // Unreduced
+		{
+			return _dividend;
+		}
+
+		s_type divisor() const
+		{
+			return _divisor;
+		}
+
+		value_type value() const // Reduced
+		{
+			return value_type(_dividend, _divisor);
+		}
+
+		void reduce()
+		{
+			const s_type factor = greatest_common_divisor(magnitude(_dividend), _divisor);
+			_dividend /= d_type(factor);
+			_divisor /= factor;
+		}
+
+		int compare(const rational_accumulator& other) const // Sign of *this - other, exact without reducing either side
+		{
+			const int sign = (_dividend > 0) - (_dividend < 0), other_sign = (other._dividend > 0) - (other._dividend < 0);
+			if (sign != other_sign || sign == 0)
+				return sign - other_sign;
+			const int order = compare_fractions(magnitude(_dividend), _divisor, magnitude(other._dividend), other._divisor);
+			return sign < 0 ? -order : order;
+		}
+
+		rational_accumulator& operator++()
+		{
+			return accumulate(d_type(1), s_type(1), false);
+		}
+
+		rational_accumulator& operator--()
+		{
+			return accumulate(d_type(1), s_type(1), true);
+		}
+
+		rational_accumulator& operator+=(const rational_accumulator& num)
+		{
+			return accumulate(num._dividend, num._divisor, false);
+		}
+
+		rational_accumulator& operator-=(const rational_accumulator& num)
+		{
+			return accumulate(num._dividend, num._divisor, true);
+		}
+
+		rational_accumulator& operator*=(const rational_accumulator& num)
+		{
+			d_type dividend;
+			s_type divisor;
+			if (bounded && !multiply_overflow(_dividend, num._dividend, dividend) && !multiply_overflow(_divisor, num._divisor, divisor))
+			{
+				_dividend = dividend;
+				_divisor = divisor;
+				return *this;
+			}
+			return *this = value() * num.value();
+		}
+
+		rational_accumulator& operator/=(const rational_accumulator& num) // num != 0
+		{
+			d_type dividend;
+			s_type divisor;
+			if (bounded && fits(num._divisor) && !multiply_overflow(_dividend, d_type(num._divisor), dividend) && !multiply_overflow(_divisor, magnitude(num._dividend), divisor))
+			{
+				_dividend = num._dividend < 0 ? -dividend : dividend;
+				_divisor = divisor;
+				return *this;
+			}
+			return *this = value() / num.value();
+		}
+
+		friend bool operator==(const rational_accumulator& a, const rational_accumulator& b)
+		{
+			return a.compare(b) == 0;
+		}
+
+		friend bool operator!=(const rational_accumulator& a, const rational_accumulator& b)
+		{
+			return a.compare(b) != 0;
+		}
+
+		friend bool operator<(const rational_accumulator& a, const rational_accumulator& b)
+		{
+			return a.compare(b) < 0;
+		}
+
+		friend bool operator>(const rational_accumulator& a, const rational_accumulator& b)
+		{
+			return a.compare(b) > 0;
+		}
+
+		friend bool operator<=(const rational_accumulator& a, const rational_accumulator& b)
+		{
+			return a.compare(b) <= 0;
+		}
+
+		friend bool operator>=(const rational_accumulator& a, const rational_accumulator& b)
+		{
+			return a.compare(b) >= 0;
+		}
+
+	private:
+		d_type _dividend;
+		s_type _divisor;
+
+		static constexpr bool bounded = std::numeric_limits<d_type>::is_bounded && std::numeric_limits<s_type>::is_bounded; // Without overflow to stop them, unreduced products of unbounded integers only grow
+
+		static s_type magnitude(d_type d)
+		{
+			return d < 0 ? s_type(0) - s_type(d) : s_type(d);
+		}
+
+		static bool fits(s_type s) // s converts to d_type unchanged
+		{
+			return !std::numeric_limits<d_type>::is_bounded || s <= s_type(std::numeric_limits<d_type>::max());
+		}
+
+		rational_accumulator& accumulate(d_type c, s_type d, bool negative) // Equal divisors add as integers, whichever divisor divides the other is scaled up to it, others are cross-multiplied; on overflow the sum is taken reduced
+		{
+			d_type left = _dividend, right = c, sum;
+			s_type divisor = _divisor;
+			bool overflow = false;
+			if (d != _divisor)
+			{
+				if (_divisor % d == 0)
+				{
+					const s_type quotient = _divisor / d;
+					overflow = !fits(quotient) || multiply_overflow(c, d_type(quotient), right);
+				}
+				else if (d % _divisor == 0)
+				{
+					const s_type quotient = d / _divisor;
+					overflow = !fits(quotient) || multiply_overflow(_dividend, d_type(quotient), left);
+					divisor = d;
+				}
+				else if (bounded)
+					overflow = !fits(d) || !fits(_divisor) || multiply_overflow(_dividend, d_type(d), left) || multiply_overflow(c, d_type(_divisor), right) || multiply_overflow(_divisor, d, divisor);
+				else
+					overflow = true;
+			}
+			if (!overflow && !(negative ? subtract_overflow(left, right, sum) : add_overflow(left, right, sum)))
+			{
+				_dividend = sum;
+				_divisor = divisor;
+				return *this;
+			}
+			value_type result = value();
+			return *this = negative ? result -= value_type(c, d) : result += value_type(c, d);
+		}
+	};
+
+	template <typename d_type, typename s_type>
+	constexpr bool rational_accumulator<d_type, s_type>::bounded;
+
 	template <typename d_type, typename s_type>
 	std::istream& operator>>(std::istream& is, rational<d_type, s_type>& num)
 	{
@@ -632,6 +1294,7 @@ namespace zaoly
 		{
 			is >> slash;
 			if (!is.fail())
+			{
 				if (slash == '/')
 				{
 					is >> s;
@@ -640,6 +1303,7 @@ namespace zaoly
 				}
 				else
 					is.clear(std::ios::failbit);
+			}
 		}
 		return is;
 	}
@@ -651,6 +1315,132 @@ namespace zaoly
 		return os;
 	}
 
+	template <typename d_type, typename s_type>
+	from_chars_result parse_rationals(const char* first, const char* last, std::vector<rational<d_type, s_type>>& results) // One fraction per line ("\n" or "\r\n", blank lines skipped) appended to results; stops at the first malformed line and returns where
+	{
+		rational<d_type, s_type> num;
+		while (first != last)
+		{
+			if (*first == '\n' || *first == '\r')
+			{
+				++first;
+				continue;
+			}
+			const from_chars_result result = from_chars(first, last, num);
+			if (result.ec != std::errc())
+				return result;
+			if (result.ptr != last && *result.ptr != '\n' && *result.ptr != '\r')
+				return { result.ptr, std::errc::invalid_argument };
+			results.push_back(num);
+			first = result.ptr;
+		}
+		return { last, std::errc() };
+	}
+
+	template <typename d_type, typename s_type>
+	void load_rationals(std::istream& is, std::vector<rational<d_type, s_type>>& results) // A newline-separated fraction file read in fixed-size blocks, appended to results; rational_format_error on a malformed line, rational_io_error when the stream fails
+	{
+		std::vector<char> block(size_t(1) << 16);
+		size_t kept = 0; // Unfinished last line of the previous block
+		for (;;)
+		{
+			is.read(block.data() + kept, std::streamsize(block.size() - kept));
+			if (is.bad())
+				throw typename rational<d_type, s_type>::rational_io_error();
+			const size_t filled = kept + size_t(is.gcount());
+			const bool end = filled < block.size();
+			const char* stop = block.data() + filled;
+			if (!end)
+			{
+				while (stop != block.data() && stop[-1] != '\n')
+					--stop;
+				if (stop == block.data()) // One line longer than the block
+				{
+					kept = filled;
+					block.resize(block.size() * 2);
+					continue;
+				}
+			}
+			if (parse_rationals(block.data(), stop, results).ec != std::errc())
+				throw typename rational<d_type, s_type>::rational_format_error();
+			kept = size_t(block.data() + filled - stop);
+			std::memmove(block.data(), stop, kept);
+			if (end)
+				return;
+		}
+	}
+
+	template <typename d_type, typename s_type>
+	void load_rationals(const std::string& path, std::vector<rational<d_type, s_type>>& results)
+	{
+		std::ifstream is(path, std::ios::binary);
+		if (!is)
+			throw typename rational<d_type, s_type>::rational_io_error();
+		load_rationals(is, results);
+	}
+
+	class rational_writer // Formats fractions into a caller's buffer, each followed by the separator; a full buffer goes to the sink, if any, and is reused
+	{
+	public:
+		rational_writer(char* buffer, size_t size, std::ostream* sink = nullptr, char separator = '\n') : _buffer(buffer), _position(buffer), _end(buffer + size), _sink(sink), _separator(separator) {}
+
+		rational_writer(const rational_writer&) = delete;
+		rational_writer& operator=(const rational_writer&) = delete;
+
+		~rational_writer()
+		{
+			flush();
+		}
+
+		template <typename d_type, typename s_type>
+		bool write(const rational<d_type, s_type>& num) // False when the fraction does not fit and there is no sink to make room
+		{
+			for (;;)
+			{
+				const to_chars_result result = to_chars(_position, _end, num);
+				if (result.ec == std::errc() && result.ptr != _end)
+				{
+					*result.ptr = _separator;
+					_position = result.ptr + 1;
+					return true;
+				}
+				if (_sink == nullptr)
+					return false;
+				if (_position == _buffer) // Longer than the whole buffer
+					return bool(*_sink << num << _separator);
+				flush();
+			}
+		}
+
+		void flush() // Hands the buffered text to the sink
+		{
+			if (_sink == nullptr)
+				return;
+			_sink->write(_buffer, _position - _buffer);
+			_position = _buffer;
+		}
+
+		const char* data() const
+		{
+			return _buffer;
+		}
+
+		size_t size() const // Characters buffered and not yet flushed
+		{
+			return size_t(_position - _buffer);
+		}
+
+		void clear()
+		{
+			_position = _buffer;
+		}
+
+	private:
+		char* _buffer, * _position, * _end;
+		std::ostream* _sink;
+		char _separator;
+	};
+
 	template <typename d_type, typename s_type>
 	rational<d_type, s_type> rational_div(d_type d, d_type s)
 	{
@@ -0,0 +1,290 @@
+#pragma once
+
+#include "matrix.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace zaoly
+{
+	template <typename number>
+	struct sparse_entry // One (row, column, value) triplet
+	{
+		size_t row, column;
+		number value;
+	};
+
+	template <typename number>
+	class sparse_matrix // Compressed sparse row storage, the compressed columns of a matrix are the rows of its transpose()
+	{
+	public:
+		sparse_matrix(size_t row_count, size_t column_count) :
+			_row_count(row_count), _column_count(column_count), _row_offsets(row_count + 1)
+		{
+			if (row_count <= 0 || column_count <= 0)
+				throw matrix_too_small();
+		}
+
+		sparse_matrix(size_t row_count, size_t column_count, std::vector<sparse_entry<number>> entries) : // Duplicate positions are summed
+			sparse_matrix(row_count, column_count)
+		{
+			std::sort(entries.begin(), entries.end(), [](const sparse_entry<number>& a, const sparse_entry<number>& b)
+			{
+				return a.row < b.row || (a.row == b.row && a.column < b.column);
+			});
+			for (size_t index = 0; index < entries.size(); ++index)
+			{
+				const sparse_entry<number>& entry = entries[index];
+				if (entry.row >= _row_count || entry.column >= _column_count)
+					throw subscript_out_of_range();
+				if (index > 0 && entry.row == entries[index - 1].row && entry.column == entries[index - 1].column)
+					_values.back() += entry.value;
+				else
+				{
+					_column_indices.push_back(entry.column);
+					_values.push_back(entry.value);
+					++_row_offsets[entry.row + 1];
+				}
+			}
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+				_row_offsets[row_index + 1] += _row_offsets[row_index];
+		}
+
+		explicit sparse_matrix(const matrix<number>& dense) : sparse_matrix(dense.row_count(), dense.column_count())
+		{
+			const number* src = dense.data();
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+			{
+				for (size_t column_index = 0; column_index < _column_count; ++column_index)
+					if (src[row_index * _column_count + column_index] != number{})
+					{
+						_column_indices.push_back(column_index);
+						_values.push_back(src[row_index * _column_count + column_index]);
+					}
+				_row_offsets[row_index + 1] = _values.size();
+			}
+		}
+
+		size_t row_count() const
+		{
+			return _row_count;
+		}
+
+		size_t column_count() const
+		{
+			return _column_count;
+		}
+
+		size_t non_zero_count() const
+		{
+			return _values.size();
+		}
+
+		const std::vector<size_t>& row_offsets() const // Row i occupies [row_offsets()[i], row_offsets()[i + 1]) of the other arrays
+		{
+			return _row_offsets;
+		}
+
+		const std::vector<size_t>& column_indices() const
+		{
+			return _column_indices;
+		}
+
+		const std::vector<number>& values() const
+		{
+			return _values;
+		}
+
+		number data(size_t row_index, size_t column_index) const
+		{
+			if (row_index >= _row_count || column_index >= _column_count)
+				throw subscript_out_of_range();
+			const auto first = _column_indices.begin() + _row_offsets[row_index], last = _column_indices.begin() + _row_offsets[row_index + 1];
+			const auto found = std::lower_bound(first, last, column_index);
+			if (found == last || *found != column_index)
+				return number{};
+			return _values[found - _column_indices.begin()];
+		}
+
+		matrix<number> to_dense() const
+		{
+			matrix<number> result(_row_count, _column_count);
+			number* dest = result.data();
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+				for (size_t index = _row_offsets[row_index]; index < _row_offsets[row_index + 1]; ++index)
+					dest[row_index * _column_count + _column_indices[index]] = _values[index];
+			return result;
+		}
+
+		sparse_matrix transpose() const // Counting sort by column, O(rows + columns + non-zeros)
+		{
+			sparse_matrix result(_column_count, _row_count);
+			result._column_indices.resize(_values.size());
+			result._values.resize(_values.size());
+			for (size_t column_index : _column_indices)
+				++result._row_offsets[column_index + 1];
+			for (size_t column_index = 0; column_index < _column_count; ++column_index)
+				result._row_offsets[column_index + 1] += result._row_offsets[column_index];
+			std::vector<size_t> next(result._row_offsets.begin(), result._row_offsets.end() - 1);
+			for (size_t row_index = 0; row_index < _row_count; ++row_index)
+				for (size_t index = _row_offsets[row_index]; index < _row_offsets[row_index + 1]; ++index)
+				{
+					const size_t position = next[_column_indices[index]]++;
+					result._column_indices[position] = row_index;
+					result._values[position] = _values[index];
+				}
+			return result;
+		}
+
+		void multiply_rows(const number* x, number* y, size_t row_begin, size_t row_end) const // y = A * x over a range of rows
+		{
+			for (size_t row_index = row_begin; row_index < row_end; ++row_index)
+			{
+				number sum{};
+				for (size_t index = _row_offsets[row_index]; index < _row_offsets[row_index + 1]; ++index)
+					sum += _values[index] * x[_column_indices[index]];
+				y[row_index] = sum;
+			}
+		}
+
+		void multiply_rows(const matrix<number>& b, matrix<number>& c, size_t row_begin, size_t row_end) const // C = A * B over a range of rows
+		{
+			const size_t n = b.column_count();
+			const number* src = b.data();
+			number* dest = c.data();
+			for (size_t row_index = row_begin; row_index < row_end; ++row_index)
+			{
+				number* c_row = dest + row_index * n;
+				std::fill(c_row, c_row + n, number{});
+				for (size_t index = _row_offsets[row_index]; index < _row_offsets[row_index + 1]; ++index)
+				{
+					const number a_element = _values[index];
+					const number* b_row = src + _column_indices[index] * n;
+					for (size_t column_index = 0; column_index < n; ++column_index)
+						c_row[column_index] += a_element * b_row[column_index];
+				}
+			}
+		}
+
+		template <typename element>
+		friend sparse_matrix<element> operator*(const sparse_matrix<element>& a, const sparse_matrix<element>& b);
+
+	private:
+		size_t _row_count, _column_count;
+		std::vector<size_t> _row_offsets;
+		std::vector<size_t> _column_indices;
+		std::vector<number> _values;
+	};
+
+	template <typename number>
+	void multiply_into(std::vector<number>& y, const sparse_matrix<number>& a, const std::vector<number>& x) // y = A * x, y must not be x
+	{
+		if (a.column_count() != x.size())
+			throw matrix_unaligned();
+		y.resize(a.row_count());
+		a.multiply_rows(x.data(), y.data(), 0, a.row_count());
+	}
+
+	template <typename number>
+	std::vector<number> operator*(const sparse_matrix<number>& a, const std::vector<number>& x)
+	{
+		std::vector<number> result;
+		multiply_into(result, a, x);
+		return result;
+	}
+
+	template <typename number>
+	matrix<number> operator*(const sparse_matrix<number>& a, const matrix<number>& b)
+	{
+		if (a.column_count() != b.row_count())
+			throw matrix_unaligned();
+		matrix<number> result(a.row_count(), b.column_count());
+		a.multiply_rows(b, result, 0, a.row_count());
+		return result;
+	}
+
+	template <typename number>
+	matrix<number> operator*(const matrix<number>& a, const sparse_matrix<number>& b) // Each non-zero of B scatters a column of A into the result
+	{
+		if (a.column_count() != b.row_count())
+			throw matrix_unaligned();
+		const size_t m = a.row_count(), n = b.column_count(), k = a.column_count();
+		matrix<number> result(m, n);
+		const number* src = a.data();
+		number* dest = result.data();
+		for (size_t row_index = 0; row_index < m; ++row_index)
+			for (size_t mid_index = 0; mid_index < k; ++mid_index)
+			{
+				const number a_element = src[row_index * k + mid_index];
+				if (a_element == number{})
+					continue;
+				for (size_t index = b.row_offsets()[mid_index]; index < b.row_offsets()[mid_index + 1]; ++index)
+					dest[row_index * n + b.column_indices()[index]] += a_element * b.values()[index];
+			}
+		return result;
+	}
+
+	template <typename number>
+	sparse_matrix<number> operator*(const sparse_matrix<number>& a, const sparse_matrix<number>& b) // Gustavson's row-by-row product with a dense accumulator
+	{
+		if (a._column_count != b._row_count)
+			throw matrix_unaligned();
+		sparse_matrix<number> result(a._row_count, b._column_count);
+		std::vector<number> accumulator(b._column_count);
+		std::vector<size_t> marker(b._column_count, size_t(-1));
+		std::vector<size_t> columns;
+		for (size_t row_index = 0; row_index < a._row_count; ++row_index)
+		{
+			columns.clear();
+			for (size_t a_index = a._row_offsets[row_index]; a_index < a._row_offsets[row_index + 1]; ++a_index)
+			{
+				const size_t mid_index = a._column_indices[a_index];
+				for (size_t b_index = b._row_offsets[mid_index]; b_index < b._row_offsets[mid_index + 1]; ++b_index)
+				{
+					const size_t column_index = b._column_indices[b_index];
+					if (marker[column_index] != row_index)
+					{
+						marker[column_index] = row_index;
+						accumulator[column_index] = number{};
+						columns.push_back(column_index);
+					}
+					accumulator[column_index] += a._values[a_index] * b._values[b_index];
+				}
+			}
+			std::sort(columns.begin(), columns.end());
+			for (size_t column_index : columns)
+				if (accumulator[column_index] != number{})
+				{
+					result._column_indices.push_back(column_index);
+					result._values.push_back(accumulator[column_index]);
+				}
+			result._row_offsets[row_index + 1] = result._values.size();
+		}
+		return result;
+	}
+
+	template <typename number>
+	std::vector<number> multiply(const sparse_matrix<number>& a, const std::vector<number>& x, const parallel_policy& policy) // Rows are split across the pool
+	{
+		if (a.column_count() != x.size())
+			throw matrix_unaligned();
+		std::vector<number> result(a.row_count());
+		policy.get_pool().parallel_for(0, a.row_count(), 256, [&](size_t row_begin, size_t row_end)
+		{
+			a.multiply_rows(x.data(), result.data(), row_begin, row_end);
+		});
+		return result;
+	}
+
+	template <typename number>
+	matrix<number> multiply(const sparse_matrix<number>& a, const matrix<number>& b, const parallel_policy& policy)
+	{
+		if (a.column_count() != b.row_count())
+			throw matrix_unaligned();
+		matrix<number> result(a.row_count(), b.column_count());
+		policy.get_pool().parallel_for(0, a.row_count(), 64, [&](size_t row_begin, size_t row_end)
+		{
+			a.multiply_rows(b, result, row_begin, row_end);
+		});
+		return result;
+	}
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "rational.hpp"
+#include <ratio>
+#include <type_traits>
+
+namespace zaoly
+{
+	template <typename tag = void>
+	struct de_bruijn_positions // Bit positions indexed by the top six bits of (1 << position) * 0x022fdd63cc95386d, for a count of trailing zeros in constant expressions on any compiler
+	{
+		static constexpr unsigned char table[64] =
+		{
+			0, 1, 2, 53, 3, 7, 54, 27, 4, 38, 41, 8, 34, 55, 48, 28, 62, 5, 39, 46, 44, 42, 22, 9, 24, 35, 59, 56, 49, 18, 29, 11,
+			63, 52, 6, 26, 37, 40, 33, 47, 61, 45, 43, 21, 23, 58, 17, 10, 51, 25, 36, 32, 60, 20, 57, 16, 50, 31, 19, 15, 30, 14, 13, 12
+		};
+	};
+
+	template <typename tag>
+	constexpr unsigned char de_bruijn_positions<tag>::table[64];
+
+	constexpr int constant_trailing_zeros(unsigned long long value) // value != 0; count_trailing_zeros for constant expressions, where MSVC's _BitScanForward is not usable
+	{
+		return de_bruijn_positions<>::table[((value & (0 - value)) * 0x022fdd63cc95386dull) >> 58];
+	}
+
+	constexpr unsigned long long constant_gcd(unsigned long long a, unsigned long long b) // greatest_common_divisor on constant_trailing_zeros (gcd(0, b) = b)
+	{
+		if (a == 0)
+			return b;
+		if (b == 0)
+			return a;
+		const int a_zeros = constant_trailing_zeros(a), b_zeros = constant_trailing_zeros(b);
+		a >>= a_zeros;
+		b >>= b_zeros;
+		while (a != b)
+		{
+			if (a < b)
+				b = (b - a) >> constant_trailing_zeros(b - a);
+			else
+				a = (a - b) >> constant_trailing_zeros(a - b);
+		}
+		return a << (a_zeros < b_zeros ? a_zeros : b_zeros);
+	}
+
+	struct static_fraction // A static_rational value as sign, magnitude and divisor, for compile-time arithmetic that records an overflow instead of wrapping
+	{
+		bool negative;
+		unsigned long long magnitude, divisor;
+		bool overflow; // The value does not fit static_rational, or an intermediate product did not fit 64 bits
+
+		constexpr long long dividend() const
+		{
+			return negative ? -(long long)(magnitude - 1) - 1 : (long long)magnitude;
+		}
+	};
+
+	constexpr static_fraction make_static_fraction(bool negative, unsigned long long magnitude, unsigned long long divisor, bool overflow) // Reduced; zero is never negative, and a magnitude past the range of long long is an overflow
+	{
+		if (overflow || divisor == 0)
+			return { false, 0, 1, true };
+		const unsigned long long factor = constant_gcd(magnitude, divisor);
+		magnitude /= factor;
+		return { negative && magnitude != 0, magnitude, divisor / factor, magnitude > (negative ? 1ull << 63 : (1ull << 63) - 1) };
+	}
+
+	constexpr static_fraction static_fraction_add(const static_fraction& a, const static_fraction& b, bool subtract) // a/b +- c/d = (a * d/g +- c * b/g) / (b/g * d) with g = gcd(b, d)
+	{
+		const unsigned long long factor = constant_gcd(a.divisor, b.divisor);
+		unsigned long long left = 0, right = 0, divisor = 0;
+		const bool overflow = a.overflow || b.overflow || multiply_overflow(a.magnitude, b.divisor / factor, left) || multiply_overflow(b.magnitude, a.divisor / factor, right) || multiply_overflow(a.divisor / factor, b.divisor, divisor);
+		const bool right_negative = b.negative != subtract;
+		if (a.negative == right_negative)
+		{
+			unsigned long long sum = 0;
+			const bool sum_overflow = add_overflow(left, right, sum);
+			return make_static_fraction(a.negative, sum, divisor, overflow || sum_overflow);
+		}
+		return left >= right ? make_static_fraction(a.negative, left - right, divisor, overflow) : make_static_fraction(right_negative, right - left, divisor, overflow);
+	}
+
+	constexpr static_fraction static_fraction_multiply(const static_fraction& a, const static_fraction& b, bool divide) // Cross-cancelled like rational's *=; dividing multiplies by the reciprocal (c != 0)
+	{
+		const unsigned long long c = divide ? b.divisor : b.magnitude, d = divide ? b.magnitude : b.divisor;
+		const unsigned long long g1 = constant_gcd(a.magnitude, d), g2 = constant_gcd(c, a.divisor);
+		unsigned long long magnitude = 0, divisor = 0;
+		const bool overflow = a.overflow || b.overflow || d == 0 || multiply_overflow(a.magnitude / g1, c / g2, magnitude) || multiply_overflow(a.divisor / g2, d / g1, divisor);
+		return make_static_fraction(a.negative != b.negative, magnitude, divisor, overflow);
+	}
+
+	constexpr int static_fraction_compare(const static_fraction& a, const static_fraction& b) // Sign of a - b, through the continued fractions like compare_fractions so no product can overflow
+	{
+		if (a.negative != b.negative)
+			return a.negative ? -1 : 1;
+		unsigned long long x = a.magnitude, y = a.divisor, z = b.magnitude, w = b.divisor;
+		for (int sign = a.negative ? -1 : 1;; sign = -sign)
+		{
+			const unsigned long long p = x / y, q = z / w;
+			if (p != q)
+				return p < q ? -sign : sign;
+			x -= p * y;
+			z -= q * w;
+			if (x == 0 || z == 0)
+				return x == 0 ? (z == 0 ? 0 : -sign) : sign;
+			const unsigned long long next_x = y, next_z = w; // Both fractional parts are positive, so x/y < z/w exactly when y/x > w/z
+			y = x;
+			w = z;
+			x = next_x;
+			z = next_z;
+		}
+	}
+
+	template <long long _dividend, unsigned long long _divisor = 1>
+	struct static_rational // Compile-time rational like std::ratio, reduced by its own constexpr arithmetic; converts to any rational and scales measurement ratios
+	{
+		static_assert(_divisor != 0, "Divisor of static_rational is zero");
+
+		static constexpr static_fraction fraction = make_static_fraction(_dividend < 0, _dividend < 0 ? 0 - (unsigned long long)_dividend : (unsigned long long)_dividend, _divisor, false);
+		static constexpr long long dividend = fraction.dividend();
+		static constexpr unsigned long long divisor = fraction.divisor;
+
+		using type = static_rational<dividend, divisor>; // The reduced form
+
+		template <typename d_type, typename s_type>
+		constexpr operator rational<d_type, s_type>() const
+		{
+			return rational<d_type, s_type>(d_type(dividend), s_type(divisor));
+		}
+	};
+
+	template <long long _dividend, unsigned long long _divisor>
+	constexpr static_fraction static_rational<_dividend, _divisor>::fraction;
+
+	template <long long _dividend, unsigned long long _divisor>
+	constexpr long long static_rational<_dividend, _divisor>::dividend;
+
+	template <long long _dividend, unsigned long long _divisor>
+	constexpr unsigned long long static_rational<_dividend, _divisor>::divisor;
+
+	template <typename std_ratio>
+	using static_rational_from = static_rational<std_ratio::num, std_ratio::den>; // std::ratio keeps its divisor positive
+
+	template <typename a, typename b, char operation>
+	struct static_rational_arithmetic // One operation on two static_rational types; as with std::ratio_add and the like, an overflow is a compile error whatever ZAOLY_RATIONAL_CHECKED says
+	{
+		static_assert(operation != '/' || b::dividend != 0, "static_rational division by zero");
+
+		static constexpr static_fraction fraction = operation == '+' || operation == '-' ? static_fraction_add(a::fraction, b::fraction, operation == '-') : static_fraction_multiply(a::fraction, b::fraction, operation == '/');
+
+		static_assert(!fraction.overflow, "static_rational arithmetic overflow");
+
+		using type = static_rational<fraction.dividend(), fraction.divisor>;
+	};
+
+	template <typename a, typename b, char operation>
+	constexpr static_fraction static_rational_arithmetic<a, b, operation>::fraction;
+
+	// Arithmetic and comparison of two static_rational types, as std::ratio_add and the like
+
+	template <typename a, typename b>
+	using static_rational_add = typename static_rational_arithmetic<a, b, '+'>::type;
+
+	template <typename a, typename b>
+	using static_rational_subtract = typename static_rational_arithmetic<a, b, '-'>::type;
+
+	template <typename a, typename b>
+	using static_rational_multiply = typename static_rational_arithmetic<a, b, '*'>::type;
+
+	template <typename a, typename b>
+	using static_rational_divide = typename static_rational_arithmetic<a, b, '/'>::type; // b != 0
+
+	template <typename a, typename b>
+	struct static_rational_equal : std::integral_constant<bool, (static_fraction_compare(a::fraction, b::fraction) == 0)> {};
+
+	template <typename a, typename b>
+	struct static_rational_not_equal : std::integral_constant<bool, (static_fraction_compare(a::fraction, b::fraction) != 0)> {};
+
+	template <typename a, typename b>
+	struct static_rational_less : std::integral_constant<bool, (static_fraction_compare(a::fraction, b::fraction) < 0)> {};
+
+	template <typename a, typename b>
+	struct static_rational_less_equal : std::integral_constant<bool, (static_fraction_compare(a::fraction, b::fraction) <= 0)> {};
+
+	template <typename a, typename b>
+	struct static_rational_greater : std::integral_constant<bool, (static_fraction_compare(a::fraction, b::fraction) > 0)> {};
+
+	template <typename a, typename b>
+	struct static_rational_greater_equal : std::integral_constant<bool, (static_fraction_compare(a::fraction, b::fraction) >= 0)> {};
+
+	// Scaling a rational by a static_rational:
+
+	template <typename d_type, typename s_type, long long _dividend, unsigned long long _divisor>
+	constexpr rational<d_type, s_type> operator*(const rational<d_type, s_type>& a, static_rational<_dividend, _divisor> b)
+	{
+		return a * rational<d_type, s_type>(b);
+	}
+
+	template <typename d_type, typename s_type, long long _dividend, unsigned long long _divisor>
+	constexpr rational<d_type, s_type> operator*(static_rational<_dividend, _divisor> a, const rational<d_type, s_type>& b)
+	{
+		return rational<d_type, s_type>(a) * b;
+	}
+
+	template <typename d_type, typename s_type, long long _dividend, unsigned long long _divisor>
+	constexpr rational<d_type, s_type> operator/(const rational<d_type, s_type>& a, static_rational<_dividend, _divisor> b) // b != 0
+	{
+		return a / rational<d_type, s_type>(b);
+	}
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace zaoly
+{
+	class thread_pool // Work-stealing pool: each worker pops its own queue from the back and steals from the front of others
+	{
+	public:
+		using task_type = std::function<void()>;
+
+		thread_pool(size_t thread_count = std::thread::hardware_concurrency())
+		{
+			if (thread_count == 0)
+				thread_count = 1;
+			for (size_t index = 0; index < thread_count; ++index)
+				_queues.emplace_back(new task_queue);
+			for (size_t index = 0; index < thread_count; ++index)
+				_workers.emplace_back(&thread_pool::work, this, index);
+		}
+
+		thread_pool(const thread_pool&) = delete;
+
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		~thread_pool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_sleep_mutex);
+				_stop = true;
+			}
+			_wake.notify_all();
+			for (std::thread& worker : _workers)
+				worker.join();
+		}
+
+		static thread_pool& global() // Shared pool used by zaoly::par unless another pool is given
+		{
+			static thread_pool pool;
+			return pool;
+		}
+
+		size_t thread_count() const
+		{
+			return _workers.size();
+		}
+
+		void submit(task_type task)
+		{
+			const size_t self = current_worker();
+			const size_t queue_index = self < _queues.size() ? self : _next_queue++ % _queues.size();
+			{
+				std::lock_guard<std::mutex> lock(_sleep_mutex);
+				++_pending;
+			}
+			{
+				std::lock_guard<std::mutex> lock(_queues[queue_index]->mutex);
+				_queues[queue_index]->tasks.push_back(std::move(task));
+			}
+			_wake.notify_one();
+		}
+
+		// Calls func(chunk_begin, chunk_end) over [begin, end) in chunks of at least grain, the calling thread helps until all are done
+		template <typename function_type>
+		void parallel_for(size_t begin, size_t end, size_t grain, const function_type& func)
+		{
+			if (begin >= end)
+				return;
+			if (grain == 0)
+				grain = 1;
+			const size_t chunk = std::max(grain, (end - begin + thread_count() * 4 - 1) / (thread_count() * 4));
+			const size_t chunk_count = (end - begin + chunk - 1) / chunk;
+			if (chunk_count == 1)
+			{
+				func(begin, end);
+				return;
+			}
+			std::atomic<size_t> remaining(chunk_count - 1);
+			std::exception_ptr error;
+			std::mutex error_mutex;
+			const auto run_chunk = [&func, &error, &error_mutex](size_t chunk_begin, size_t chunk_end)
+			{
+				try
+				{
+					func(chunk_begin, chunk_end);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(error_mutex);
+					if (!error)
+						error = std::current_exception();
+				}
+			};
+			for (size_t index = 1; index < chunk_count; ++index)
+			{
+				const size_t chunk_begin = begin + index * chunk, chunk_end = std::min(end, chunk_begin + chunk);
+				submit([&run_chunk, &remaining, chunk_begin, chunk_end]
+				{
+					run_chunk(chunk_begin, chunk_end);
+					--remaining;
+				});
+			}
+			run_chunk(begin, begin + chunk);
+			while (remaining > 0)
+				if (!run_one())
+					std::this_thread::yield();
+			if (error)
+				std::rethrow_exception(error);
+		}
+
+	private:
+		struct task_queue
+		{
+			std::mutex mutex;
+			std::deque<task_type> tasks;
+		};
+
+		std::vector<std::unique_ptr<task_queue>> _queues;
+		std::vector<std::thread> _workers;
+		std::atomic<size_t> _next_queue{};
+		std::mutex _sleep_mutex;
+		std::condition_variable _wake;
+		size_t _pending{}; // Guarded by _sleep_mutex
+		bool _stop = false;
+
+		static const thread_pool*& worker_owner()
+		{
+			thread_local const thread_pool* owner = nullptr;
+			return owner;
+		}
+
+		static size_t& worker_index()
+		{
+			thread_local size_t index = size_t(-1);
+			return index;
+		}
+
+		size_t current_worker() const // Index of the calling worker in this pool, or -1 for other threads
+		{
+			return worker_owner() == this ? worker_index() : size_t(-1);
+		}
+
+		bool take(size_t queue_index, bool own, task_type& task)
+		{
+			task_queue& queue = *_queues[queue_index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty())
+				return false;
+			if (own)
+			{
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+			}
+			else
+			{
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+			}
+			return true;
+		}
+
+		bool run_one()
+		{
+			task_type task;
+			const size_t self = current_worker();
+			bool found = self < _queues.size() && take(self, true, task);
+			for (size_t offset = 1; !found && offset <= _queues.size(); ++offset)
+				found = take((self + offset) % _queues.size(), false, task);
+			if (!found)
+				return false;
+			{
+				std::lock_guard<std::mutex> lock(_sleep_mutex);
+				--_pending;
+			}
+			task();
+			return true;
+		}
+
+		void work(size_t index)
+		{
+			worker_owner() = this;
+			worker_index() = index;
+			for (;;)
+			{
+				if (run_one())
+					continue;
+				std::unique_lock<std::mutex> lock(_sleep_mutex);
+				_wake.wait(lock, [this] { return _stop || _pending > 0; });
+				if (_stop && _pending == 0)
+					return;
+			}
+		}
+	};
+
+	struct parallel_policy // Opt-in parallel execution, runs on the given pool or thread_pool::global()
+	{
+		thread_pool* pool = nullptr;
+
+		thread_pool& get_pool() const
+		{
+			return pool ? *pool : thread_pool::global();
+		}
+	};
+
+	constexpr parallel_policy par{};
+}
@@ -2,9 +2,14 @@
 #pragma warning(push)
 #pragma warning(disable: 26495) // C26495: Variable '...' is uninitialized. Always initialize a member variable (type. 6)
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <fstream>
+#include <future>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
 
 namespace zaoly
 {
@@ -120,6 +125,8 @@ public:                                           \
 	EXCEPTION_CLASS(type_mismatch, "Type mismatch")
 	EXCEPTION_CLASS(fail_to_read_wav, "Fail to read WAV")
 	EXCEPTION_CLASS(fail_to_write_wav, "Fail to write WAV")
+	EXCEPTION_CLASS(moment_out_of_range, "Moment out of range")
+	EXCEPTION_CLASS(block_of_no_moment, "Block of no moment")
 
 	class wav_file
 	{
@@ -572,6 +579,8 @@ auto function_name() const               \
 		}
 
 	private:
+		friend class wav_reader;
+
 		const uint32_t min_size_no_header = 36;
 
 		template <typename string_type>
@@ -822,6 +831,304 @@ auto function_name() const               \
 		WAV32BIT* _data_32bit = nullptr;
 		WAV32BIT_FLOAT* _data_32bit_float = nullptr;
 	};
+
+	class wav_reader // Streams the data of a WAV file in blocks of a fixed number of moments; only two blocks are held, the next one being read in the background
+	{
+	public:
+		using WAV8BIT = wav_file::WAV8BIT;
+		using WAV16BIT = wav_file::WAV16BIT;
+		using WAV24BIT = wav_file::WAV24BIT;
+		using WAV32BIT = wav_file::WAV32BIT;
+		using WAV32BIT_FLOAT = wav_file::WAV32BIT_FLOAT;
+
+		class block // Moments [first_moment, first_moment + moments) interleaved by channel, valid until the next block is read
+		{
+		public:
+			block() {}
+
+			ACCESSOR_FUNCTION(first_moment)
+			ACCESSOR_FUNCTION(moments)
+
+			uint32_t size() const // Number of samples
+			{
+				return _moments * _channels;
+			}
+
+			const char* raw_data() const
+			{
+				return _data;
+			}
+
+			const WAV8BIT* data_8bit() const
+			{
+				check_type(1, 8);
+				return reinterpret_cast<const WAV8BIT*>(_data);
+			}
+
+			const WAV16BIT* data_16bit() const
+			{
+				check_type(1, 16);
+				return reinterpret_cast<const WAV16BIT*>(_data);
+			}
+
+			const WAV24BIT* data_24bit() const
+			{
+				check_type(1, 24);
+				return reinterpret_cast<const WAV24BIT*>(_data);
+			}
+
+			const WAV32BIT* data_32bit() const
+			{
+				check_type(1, 32);
+				return reinterpret_cast<const WAV32BIT*>(_data);
+			}
+
+			const WAV32BIT_FLOAT* data_32bit_float() const
+			{
+				check_type(3, 32);
+				return reinterpret_cast<const WAV32BIT_FLOAT*>(_data);
+			}
+
+		private:
+			friend class wav_reader;
+
+			block(const char* data, uint16_t format_type, uint16_t channels, uint16_t bits_per_sample, uint32_t first_moment, uint32_t moments) :
+				_data(data), _format_type(format_type), _channels(channels), _bits_per_sample(bits_per_sample), _first_moment(first_moment), _moments(moments) {}
+
+			void check_type(uint16_t format_type, uint16_t bits_per_sample) const
+			{
+				if (_format_type != format_type || _bits_per_sample != bits_per_sample)
+					throw type_mismatch();
+			}
+
+			const char* _data = nullptr;
+			uint16_t _format_type{};
+			uint16_t _channels{};
+			uint16_t _bits_per_sample{};
+			uint32_t _first_moment{};
+			uint32_t _moments{};
+		};
+
+		class iterator // Input iterator over the remaining blocks
+		{
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = block;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const block*;
+			using reference = const block&;
+
+			iterator(wav_reader* reader = nullptr) : _reader(reader)
+			{
+				if (_reader && !_reader->next())
+					_reader = nullptr;
+			}
+
+			reference operator*() const
+			{
+				return _reader->_block;
+			}
+
+			pointer operator->() const
+			{
+				return &_reader->_block;
+			}
+
+			iterator& operator++()
+			{
+				if (!_reader->next())
+					_reader = nullptr;
+				return *this;
+			}
+
+			friend bool operator==(const iterator& a, const iterator& b)
+			{
+				return a._reader == b._reader;
+			}
+
+			friend bool operator!=(const iterator& a, const iterator& b)
+			{
+				return a._reader != b._reader;
+			}
+
+		private:
+			wav_reader* _reader;
+		};
+
+		static const uint32_t default_block_moments = 16384;
+
+		wav_reader(const char* filename, uint32_t block_moments = default_block_moments)
+		{
+			_open(filename, block_moments);
+		}
+
+		wav_reader(const wchar_t* filename, uint32_t block_moments = default_block_moments)
+		{
+			_open(filename, block_moments);
+		}
+
+		wav_reader(const std::string& filename, uint32_t block_moments = default_block_moments)
+		{
+			_open(filename, block_moments);
+		}
+
+		wav_reader(const std::wstring& filename, uint32_t block_moments = default_block_moments)
+		{
+			_open(filename, block_moments);
+		}
+
+		wav_reader(const wav_reader&) = delete; // The background read refers to this object
+		wav_reader& operator=(const wav_reader&) = delete;
+
+		~wav_reader()
+		{
+			if (_pending.valid())
+				_pending.wait();
+		}
+
+		ACCESSOR_FUNCTION(format_type)
+		ACCESSOR_FUNCTION(channels)
+		ACCESSOR_FUNCTION(sample_rate)
+		ACCESSOR_FUNCTION(bytes_per_sec)
+		ACCESSOR_FUNCTION(bytes_per_moment)
+		ACCESSOR_FUNCTION(bits_per_sample)
+		ACCESSOR_FUNCTION(data_bytes)
+		ACCESSOR_FUNCTION(moments)
+		ACCESSOR_FUNCTION(block_moments)
+		ACCESSOR_FUNCTION(position) // First moment of the block to be read next
+
+		bool next() // Reads the next block into current(), false at the end of the data
+		{
+			if (!_pending.valid())
+				prefetch();
+			if (!_pending.valid())
+			{
+				_block = block();
+				return false;
+			}
+			_block = _pending.get();
+			_position = _block._first_moment + _block._moments;
+			prefetch();
+			return true;
+		}
+
+		const block& current() const
+		{
+			return _block;
+		}
+
+		template <typename callback_type>
+		void for_each_block(callback_type callback) // Calls callback(const block&) for each remaining block
+		{
+			while (next())
+				callback(_block);
+		}
+
+		iterator begin() // Starts from position(), so iterating twice needs a seek in between
+		{
+			return iterator(this);
+		}
+
+		iterator end()
+		{
+			return iterator();
+		}
+
+		void seek(uint32_t moment) // The next block starts from the moment; the current block stays valid
+		{
+			if (moment > _moments)
+				throw moment_out_of_range();
+			if (_pending.valid())
+			{
+				_pending.wait();
+				_back ^= 1; // Give back the buffer of the discarded block
+			}
+			_pending = std::future<block>();
+			_file.clear();
+			_file.seekg(_data_offset + static_cast<std::streamoff>(moment) * _bytes_per_moment);
+			_position = _fetched = moment;
+		}
+
+	private:
+		template <typename string_type>
+		void _open(const string_type filename, uint32_t block_moments)
+		{
+			uint32_t size_no_header{}, fmt_size{};
+			_file.open(filename, std::ios::in | std::ios::binary);
+			if (_file.fail())
+				throw fail_to_read_wav();
+			if (!wav_file::read_and_check<4>(_file, "RIFF"))
+				throw wav_format_error();
+			wav_file::read_binary(_file, size_no_header);
+			if (!wav_file::read_and_check<8>(_file, "WAVEfmt "))
+				throw wav_format_error();
+			wav_file::read_binary(_file, fmt_size);
+			wav_file::read_binary(_file, _format_type);
+			wav_file::read_binary(_file, _channels);
+			wav_file::read_binary(_file, _sample_rate);
+			wav_file::read_binary(_file, _bytes_per_sec);
+			wav_file::read_binary(_file, _bytes_per_moment);
+			wav_file::read_binary(_file, _bits_per_sample);
+			if (fmt_size < 16)
+				throw wav_format_error();
+			else if (fmt_size > 16)
+				_file.seekg(fmt_size - 16, std::ios::cur);
+			if (!wav_file::read_and_check<4>(_file, "data"))
+				throw wav_format_error();
+			wav_file::read_binary(_file, _data_bytes);
+			if (_file.fail())
+				throw fail_to_read_wav();
+			if (!((_format_type == 1 && (_bits_per_sample == 8 || _bits_per_sample == 16 || _bits_per_sample == 24 || _bits_per_sample == 32)) ||
+				(_format_type == 3 && _bits_per_sample == 32)) ||
+				_channels == 0 || _bytes_per_moment != _bits_per_sample / 8 * _channels)
+				throw wav_format_error();
+			if (block_moments == 0)
+				throw block_of_no_moment();
+			_data_offset = _file.tellg();
+			_moments = _data_bytes / _bytes_per_moment;
+			_block_moments = block_moments;
+			_buffers[0].resize(static_cast<size_t>(block_moments) * _bytes_per_moment);
+			_buffers[1].resize(static_cast<size_t>(block_moments) * _bytes_per_moment);
+		}
+
+		void prefetch() // Starts reading the block after the fetched ones into the buffer not held by current()
+		{
+			if (_fetched >= _moments)
+				return;
+			uint32_t first_moment = _fetched;
+			uint32_t moments = std::min(_block_moments, _moments - first_moment);
+			char* data = _buffers[_back].data();
+			_fetched += moments;
+			_back ^= 1;
+			_pending = std::async(std::launch::async, [this, data, first_moment, moments]
+			{
+				std::streamsize bytes = static_cast<std::streamsize>(moments) * _bytes_per_moment;
+				_file.read(data, bytes);
+				if (_file.gcount() != bytes)
+					throw fail_to_read_wav();
+				return block(data, _format_type, _channels, _bits_per_sample, first_moment, moments);
+			});
+		}
+
+		uint16_t _format_type{};
+		uint16_t _channels{};
+		uint32_t _sample_rate{};
+		uint32_t _bytes_per_sec{};
+		uint16_t _bytes_per_moment{};
+		uint16_t _bits_per_sample{};
+		uint32_t _data_bytes{};
+		uint32_t _moments{};       // data_bytes / bytes_per_moment, a trailing partial moment is ignored
+		uint32_t _block_moments{};
+		uint32_t _position{};
+		uint32_t _fetched{};       // Moments read or being read
+
+		std::ifstream _file;
+		std::streamoff _data_offset{};
+		std::vector<char> _buffers[2];
+		unsigned _back{};          // Buffer for the next prefetch
+		block _block;
+		std::future<block> _pending; // Declared last, so that it is waited for before the rest is destroyed
+	};
 }
 
 #pragma warning(pop)